@@ -0,0 +1,370 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+#include <graphgen/graphgen.h>
+
+using namespace graphgen;
+
+namespace {
+
+std::atomic<size_t> numAllocations = 0;
+std::atomic<size_t> allocatedBytes = 0;
+
+} // namespace
+
+// Allocations are counted by replacing the global allocation functions. GCC
+// warns about `free()` on memory from `operator new` once they are inlined
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size) {
+    numAllocations.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+namespace {
+
+/// Sink that counts and discards its input, so generation is measured without
+/// I/O
+class NullSink: public Sink {
+public:
+    NullSink() { setBuffer(buffer, buffer, buffer + sizeof buffer); }
+
+    void flush() override {
+        noteFlushed(static_cast<size_t>(bufferCurrent() - bufferBegin()));
+        setBuffer(buffer, buffer, buffer + sizeof buffer);
+    }
+
+private:
+    void overflow(size_t) override { flush(); }
+
+    char buffer[1 << 16];
+};
+
+/// Command line options:
+/// ```
+///  graphgen_bench [--json] [--min-scale N] [--max-scale N] [--threads N]
+///                 [--filter NAME] [--format dot|json|graphml]
+/// ```
+/// With `--json` every phase is printed as one JSON object per line
+struct Options {
+    bool json = false;
+    int minScale = 3;
+    int maxScale = 6;
+    unsigned threads = 1;
+    std::string filter;
+    Format format = Format::Dot;
+};
+
+/// Synthetic workload for construction and generation throughput. Every
+/// workload is run at 10^min-scale to 10^max-scale vertices. For each run the
+/// construction and the generation phase are reported with wall time,
+/// vertices per second, output bytes per second, number and size of heap
+/// allocations and the peak resident set size of the process so far
+struct Workload {
+    char const* name;
+    std::function<std::unique_ptr<Graph>(size_t)> build;
+};
+
+struct Measurement {
+    double seconds;
+    size_t allocations;
+    size_t allocatedBytes;
+    size_t peakRSS;
+};
+
+/// \Returns the peak resident set size of the process in bytes
+size_t peakRSS() {
+#if defined(_WIN32)
+    return 0;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+Measurement measure(auto&& function) {
+    size_t allocations = numAllocations.load();
+    size_t bytes = allocatedBytes.load();
+    auto begin = std::chrono::steady_clock::now();
+    function();
+    auto end = std::chrono::steady_clock::now();
+    return { std::chrono::duration<double>(end - begin).count(),
+             numAllocations.load() - allocations,
+             allocatedBytes.load() - bytes,
+             peakRSS() };
+}
+
+/// Deterministic pseudo random numbers so runs are comparable
+struct Random {
+    uint64_t state = 0x9E3779B97F4A7C15;
+
+    size_t operator()(size_t bound) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return static_cast<size_t>(state % bound);
+    }
+};
+
+std::string label(size_t index) { return "Vertex " + std::to_string(index); }
+
+/// All vertices in the root graph, connected in a chain
+std::unique_ptr<Graph> buildFlat(size_t n) {
+    auto graph = std::make_unique<Graph>(0);
+    graph->reserveEdges(n);
+    for (size_t i = 1; i <= n; ++i) {
+        graph->emplace<Vertex>(i)->label(label(i));
+        if (i > 1) {
+            graph->add(Edge{ i - 1, i });
+        }
+    }
+    return graph;
+}
+
+/// A chain of 64 nested subgraphs with the vertices spread evenly
+std::unique_ptr<Graph> buildNested(size_t n) {
+    constexpr size_t depth = 64;
+    auto root = std::make_unique<Graph>(0);
+    Graph* graph = root.get();
+    size_t id = n + 1;
+    for (size_t level = 0, i = 1; level < depth; ++level) {
+        size_t end = n * (level + 1) / depth;
+        for (; i <= end; ++i) {
+            graph->emplace<Vertex>(i)->label(label(i));
+        }
+        graph = graph->emplace<Graph>(id++)->label("Level");
+    }
+    return root;
+}
+
+/// Few vertices with ten random edges each
+std::unique_ptr<Graph> buildEdges(size_t n) {
+    size_t numVertices = std::max<size_t>(n / 10, 1);
+    auto graph = std::make_unique<Graph>(0);
+    for (size_t i = 1; i <= numVertices; ++i) {
+        graph->emplace<Vertex>(i)->label(label(i));
+    }
+    Random random;
+    graph->reserveEdges(n);
+    for (size_t i = 0; i < n; ++i) {
+        Edge edge{ random(numVertices) + 1, random(numVertices) + 1 };
+        if (i % 4 == 0) {
+            edge.color = Color::Red;
+        }
+        graph->add(edge);
+    }
+    return graph;
+}
+
+/// Vertices with HTML table labels
+std::unique_ptr<Graph> buildHTML(size_t n) {
+    auto graph = std::make_unique<Graph>(0);
+    for (size_t i = 1; i <= n; ++i) {
+        std::string text = "<table border=\"0\"><tr><td align=\"left\">"
+                           "<font color=\"CornflowerBlue\">" +
+                           label(i) + "</font></td></tr></table>";
+        graph->emplace<Vertex>(i)->label(text, LabelKind::HTML);
+    }
+    return graph;
+}
+
+/// Vertices whose IDs are derived from the addresses of objects
+std::unique_ptr<Graph> buildPointerIDs(size_t n) {
+    struct Node {
+        size_t value;
+    };
+    auto nodes = std::make_unique<Node[]>(n);
+    auto graph = std::make_unique<Graph>(0);
+    graph->reserveEdges(n);
+    for (size_t i = 0; i < n; ++i) {
+        graph->emplace<Vertex>(ID(&nodes[i]))->label(label(i));
+        if (i > 0) {
+            graph->add(Edge{ ID(&nodes[i - 1]), ID(&nodes[i]) });
+        }
+    }
+    return graph;
+}
+
+void report(Options const& options,
+            char const* workload,
+            size_t n,
+            char const* phase,
+            Measurement const& m,
+            size_t outputBytes) {
+    double verticesPerSecond = static_cast<double>(n) / m.seconds;
+    double bytesPerSecond = static_cast<double>(outputBytes) / m.seconds;
+    if (options.json) {
+        std::printf("{\"workload\": \"%s\", \"vertices\": %zu, "
+                    "\"phase\": \"%s\", \"threads\": %u, \"seconds\": %.6f, "
+                    "\"vertices_per_second\": %.0f, \"output_bytes\": %zu, "
+                    "\"bytes_per_second\": %.0f, \"allocations\": %zu, "
+                    "\"allocated_bytes\": %zu, \"peak_rss\": %zu}\n",
+                    workload,
+                    n,
+                    phase,
+                    options.threads,
+                    m.seconds,
+                    verticesPerSecond,
+                    outputBytes,
+                    bytesPerSecond,
+                    m.allocations,
+                    m.allocatedBytes,
+                    m.peakRSS);
+        return;
+    }
+    std::printf("%-12s %10zu %-9s %9.3f ms %12.0f v/s %10.1f MB/s %10zu "
+                "allocs %10.1f MB alloc %8.1f MB rss\n",
+                workload,
+                n,
+                phase,
+                m.seconds * 1e3,
+                verticesPerSecond,
+                bytesPerSecond / 1e6,
+                m.allocations,
+                static_cast<double>(m.allocatedBytes) / 1e6,
+                static_cast<double>(m.peakRSS) / 1e6);
+}
+
+void run(Options const& options, Workload const& workload, size_t n) {
+    std::unique_ptr<Graph> graph;
+    auto construction = measure([&] { graph = workload.build(n); });
+    report(options, workload.name, n, "construct", construction, 0);
+    NullSink sink;
+    GenerateOptions generateOptions{ .threads = options.threads };
+    auto generation = measure([&] {
+        switch (options.format) {
+        case Format::Dot:
+            generate<Format::Dot>(*graph, sink, generateOptions);
+            break;
+        case Format::Json:
+            generate<Format::Json>(*graph, sink, generateOptions);
+            break;
+        case Format::GraphML:
+            generate<Format::GraphML>(*graph, sink, generateOptions);
+            break;
+        }
+    });
+    report(options,
+           workload.name,
+           n,
+           "generate",
+           generation,
+           sink.bytesWritten());
+}
+
+int parseInt(char const* text) {
+    char* end = nullptr;
+    long value = std::strtol(text, &end, 10);
+    if (!text[0] || *end) {
+        std::cerr << "Invalid number: " << text << "\n";
+        std::exit(1);
+    }
+    return static_cast<int>(value);
+}
+
+Options parseOptions(int argc, char const* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        auto value = [&] {
+            if (i + 1 == argc) {
+                std::cerr << "Missing value for " << arg << "\n";
+                std::exit(1);
+            }
+            return argv[++i];
+        };
+        if (arg == "--json") {
+            options.json = true;
+        }
+        else if (arg == "--min-scale") {
+            options.minScale = parseInt(value());
+        }
+        else if (arg == "--max-scale") {
+            options.maxScale = parseInt(value());
+        }
+        else if (arg == "--threads") {
+            options.threads = static_cast<unsigned>(parseInt(value()));
+        }
+        else if (arg == "--filter") {
+            options.filter = value();
+        }
+        else if (arg == "--format") {
+            std::string_view format = value();
+            if (format == "dot") {
+                options.format = Format::Dot;
+            }
+            else if (format == "json") {
+                options.format = Format::Json;
+            }
+            else if (format == "graphml") {
+                options.format = Format::GraphML;
+            }
+            else {
+                std::cerr << "Unknown format " << format << "\n";
+                std::exit(1);
+            }
+        }
+        else {
+            std::cerr << "Unknown option " << arg << "\n";
+            std::exit(1);
+        }
+    }
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char const* argv[]) {
+    Options options = parseOptions(argc, argv);
+    Workload const workloads[] = {
+        { "flat", buildFlat },       { "nested", buildNested },
+        { "edges", buildEdges },     { "html", buildHTML },
+        { "pointer-ids", buildPointerIDs },
+    };
+    for (auto& workload: workloads) {
+        if (!options.filter.empty() &&
+            std::string_view(workload.name).find(options.filter) ==
+                std::string_view::npos)
+        {
+            continue;
+        }
+        size_t n = 1;
+        for (int i = 0; i < options.minScale; ++i) {
+            n *= 10;
+        }
+        for (int scale = options.minScale; scale <= options.maxScale; ++scale) {
+            run(options, workload, n);
+            n *= 10;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+#ifndef GRAPHGEN_ARENA_H_
+#define GRAPHGEN_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+#include <graphgen/api.h>
+
+namespace graphgen {
+
+/// Monotonic bump allocator. Memory is handed out from a list of chunks and
+/// is only released when the arena itself is destroyed. Destructors of objects
+/// created in the arena are _not_ run by the arena
+class GRAPHGEN_API Arena {
+public:
+    Arena() = default;
+
+    Arena(Arena const&) = delete;
+
+    Arena& operator=(Arena const&) = delete;
+
+    /// Releases all chunks. This is O(number of chunks)
+    ~Arena();
+
+    /// Allocates \p size bytes aligned to \p align
+    void* allocate(std::size_t size, std::size_t align) {
+        auto addr = reinterpret_cast<std::uintptr_t>(_current);
+        auto aligned = (addr + align - 1) & ~(std::uintptr_t(align) - 1);
+        auto* result = reinterpret_cast<char*>(aligned);
+        if (_current && result + size <= _end) {
+            _current = result + size;
+            return result;
+        }
+        return allocateSlow(size, align);
+    }
+
+    /// Allocates memory for a `T` and constructs it with \p args
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        void* mem = allocate(sizeof(T), alignof(T));
+        return ::new (mem) T(std::forward<Args>(args)...);
+    }
+
+    /// Takes ownership of all chunks of \p other. Objects created in \p other
+    /// stay valid and are released with this arena. \p other is left empty.
+    /// This is O(number of chunks of \p other)
+    void absorb(Arena& other);
+
+    /// \Returns the number of chunks currently owned by the arena
+    std::size_t numChunks() const { return _numChunks; }
+
+    /// \Returns the total number of bytes owned by the arena
+    std::size_t capacity() const { return _capacity; }
+
+private:
+    struct Chunk;
+
+    void* allocateSlow(std::size_t size, std::size_t align);
+
+    char* _current = nullptr;
+    char* _end = nullptr;
+    Chunk* _head = nullptr;
+    std::size_t _numChunks = 0;
+    std::size_t _capacity = 0;
+};
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_ARENA_H_
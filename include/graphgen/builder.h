@@ -0,0 +1,148 @@
+#ifndef GRAPHGEN_BUILDER_H_
+#define GRAPHGEN_BUILDER_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <graphgen/api.h>
+#include <graphgen/arena.h>
+#include <graphgen/graph.h>
+
+namespace graphgen {
+
+/// Builds a graph from many threads at once. Every thread appends to its own
+/// shard, so appends take no locks and do not contend. Vertices are created
+/// in the arena of the shard and `build()` links them into a `Graph` without
+/// copying or moving them.
+///
+/// Vertices and edges are added to the graph with a given ID, which may be
+/// created by another thread or later. `build()` orders the children of each
+/// graph by shard, in the order the shards were created, and then in the
+/// order they were appended to the shard. The order never depends on IDs or
+/// addresses. It is reproducible if the threads add the same items and obtain
+/// their shards with `shard()` in a fixed order before they start appending:
+/// ```
+///  ConcurrentGraphBuilder builder(0);
+///  parallelFor(items, [&](Item const& item) {
+///      builder.emplace<Vertex>(item.group, ID(&item))->label(item.name);
+///  });
+///  std::unique_ptr<Graph> graph = builder.build();
+/// ```
+class GRAPHGEN_API ConcurrentGraphBuilder {
+public:
+    /// Vertices and edges added by one thread. A shard must only be used by
+    /// the thread that obtained it from `shard()`
+    class GRAPHGEN_API Shard {
+    public:
+        Shard() = default;
+
+        Shard(Shard const&) = delete;
+
+        Shard& operator=(Shard const&) = delete;
+
+        ~Shard();
+
+        /// Constructs a vertex of type \p V from \p args and adds it to the
+        /// graph with ID \p parent. Children of a graph created here must be
+        /// added through the builder, not through the graph
+        template <typename V = Vertex, typename... Args>
+        V* emplace(ID parent, Args&&... args) {
+            static_assert(std::is_base_of_v<Vertex, V>);
+            V* vertex = _arena.create<V>(std::forward<Args>(args)...);
+            ConcurrentGraphBuilder::setArenaAllocated(vertex);
+            bucket(parent).vertices.push_back(vertex);
+            return vertex;
+        }
+
+        /// Adds \p edge to the graph with ID \p parent
+        Shard& add(ID parent, Edge edge) {
+            bucket(parent).edges.push_back(edge);
+            return *this;
+        }
+
+    private:
+        friend class ConcurrentGraphBuilder;
+
+        /// Vertices and edges with the same parent graph
+        struct Bucket {
+            std::vector<Vertex*> vertices;
+            std::vector<Edge> edges;
+        };
+
+        /// Producers usually add runs of children to the same graph, so the
+        /// last bucket is cached
+        Bucket& bucket(ID parent) {
+            if (!_last || _lastParent != parent) {
+                _last = &_buckets[parent];
+                _lastParent = parent;
+            }
+            return *_last;
+        }
+
+        /// Destroys the vertices that have not been built
+        void clear();
+
+        Arena _arena;
+        std::unordered_map<ID, Bucket> _buckets;
+        Bucket* _last = nullptr;
+        ID _lastParent = 0;
+    };
+
+    /// Creates a builder for a graph with ID \p rootID
+    explicit ConcurrentGraphBuilder(ID rootID = 0);
+
+    ConcurrentGraphBuilder(ConcurrentGraphBuilder const&) = delete;
+
+    ConcurrentGraphBuilder& operator=(ConcurrentGraphBuilder const&) = delete;
+
+    /// Destroys all vertices that have not been built
+    ~ConcurrentGraphBuilder();
+
+    /// \Returns the shard of the calling thread. The first call on each thread
+    /// takes a lock and creates the shard, later calls only read a thread
+    /// local cache of the last few builders the thread has used. The order of
+    /// the first calls is the order of the shards in `build()`
+    Shard& shard();
+
+    /// Constructs a vertex in the shard of the calling thread. See
+    /// `Shard::emplace()`
+    template <typename V = Vertex, typename... Args>
+    V* emplace(ID parent, Args&&... args) {
+        return shard().emplace<V>(parent, std::forward<Args>(args)...);
+    }
+
+    /// Adds \p edge in the shard of the calling thread. See `Shard::add()`
+    ConcurrentGraphBuilder& add(ID parent, Edge edge) {
+        shard().add(parent, edge);
+        return *this;
+    }
+
+    /// Links all vertices and edges added so far into a graph and leaves the
+    /// builder empty. Must not be called concurrently with appends. Throws
+    /// `std::runtime_error` if a parent graph does not exist, if two graphs
+    /// have the same ID or if a graph is not reachable from the root. In that
+    /// case the builder is left unchanged
+    std::unique_ptr<Graph> build();
+
+private:
+    template <typename V>
+    static void setArenaAllocated(V* vertex) {
+        vertex->template setArenaAllocated<V>();
+    }
+
+    ID _rootID;
+    uint64_t _serial;
+    std::mutex _mutex;
+    std::vector<std::unique_ptr<Shard>> _shards;
+    std::unordered_map<std::thread::id, Shard*> _threadShards;
+};
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_BUILDER_H_
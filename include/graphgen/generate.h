@@ -1,20 +1,261 @@
 #ifndef GRAPHGEN_GENERATE_H_
 #define GRAPHGEN_GENERATE_H_
 
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <future>
 #include <iosfwd>
+#include <span>
+#include <vector>
 
 #include <graphgen/api.h>
+#include <graphgen/graph.h>
+#include <graphgen/reduce.h>
 
 namespace graphgen {
 
-class Graph;
+class Sink;
 
-/// Generate graphviz code for the graph \p graph and write it to \p ostream
-GRAPHGEN_API void generate(Graph const& graph, std::ostream& ostream);
+/// Statistics of one call to `generate()`. Graphs whose code is reused by
+/// incremental generation are not visited and not counted
+struct GenerateStats {
+    /// Time spent generating a top level subgraph
+    struct SubgraphTime {
+        ID id;
+        std::chrono::nanoseconds time;
+    };
+
+    /// Number of vertices that are not graphs
+    size_t vertices = 0;
+
+    /// Number of declared edges. Coalesced edges are counted once
+    size_t edges = 0;
+
+    /// Number of graphs excluding the root
+    size_t subgraphs = 0;
+
+    /// Number of bytes written to the sink
+    size_t bytesWritten = 0;
+
+    /// Maximum nesting depth of graphs. The root has depth 0
+    size_t maxDepth = 0;
+
+    /// Total time of the call
+    std::chrono::nanoseconds totalTime{};
+
+    /// Time spent in label generator callbacks. In parallel mode this is the
+    /// sum over all threads
+    std::chrono::nanoseconds labelGeneratorTime{};
+
+    /// Time spent in each subgraph of the root in declaration order. In
+    /// parallel mode this is the sum of the tasks that generated the subgraph
+    /// and its descendants
+    std::vector<SubgraphTime> subgraphTimes;
+};
+
+/// Receives callbacks when the generator opens and closes the scope of a graph
+/// or vertex, e.g. to feed a tracing system. \p depth is the nesting depth
+/// with 0 for the root. In parallel mode the callbacks of different subgraphs
+/// are invoked concurrently from the worker threads
+class GRAPHGEN_API GenerateObserver {
+public:
+    virtual ~GenerateObserver() = default;
+
+    virtual void beginGraph(Graph const& /* graph */, size_t /* depth */) {}
+
+    virtual void endGraph(Graph const& /* graph */, size_t /* depth */) {}
+
+    virtual void beginVertex(Vertex const& /* vertex */, size_t /* depth */) {}
+
+    virtual void endVertex(Vertex const& /* vertex */, size_t /* depth */) {}
+};
+
+/// How `generate()` treats edges of a graph that have the same endpoints and
+/// attributes. In undirected graphs the order of the endpoints does not matter
+enum class EdgeCoalescing {
+    /// Every edge is declared
+    None,
+
+    /// Only the first of equal edges is declared
+    Drop,
+
+    /// Equal edges are declared once with a `penwidth` that grows with the
+    /// logarithm of their number
+    PenWidth,
+
+    /// Equal edges are declared once with their number as label
+    Label,
+};
+
+/// Options to control code generation
+struct GenerateOptions {
+    /// Number of threads used to generate sibling subgraphs concurrently. The
+    /// output of each subgraph is buffered and concatenated in declaration
+    /// order, so the result does not depend on the number of threads. Values
+    /// of 0 or 1 generate everything on the calling thread
+    unsigned threads = 1;
+
+    /// Emit the most common label, font and shape of the vertices of each
+    /// graph once as `node [...]` defaults and the most common edge attributes
+    /// as `edge [...]` defaults. Values that occur only once are not hoisted.
+    /// Vertices and edges then only declare values that differ from the
+    /// defaults. The rendered graph is unchanged. Graphviz would apply the
+    /// node defaults to the vertices it creates for dangling edge endpoints,
+    /// so nothing is hoisted if the tree has edges to vertices that don't
+    /// exist. Checking this visits all edges on every call, including
+    /// incremental ones
+    bool hoistDefaults = false;
+
+    /// Run `validate()` before generating and throw `InvalidGraphError` if the
+    /// graph has duplicate IDs or edges to vertices that don't exist
+    bool validate = false;
+
+    /// Name vertices `v0`, `v1`, ... in the order they first appear in the
+    /// output instead of deriving names from the raw IDs. This makes the
+    /// output smaller and independent of the addresses pointer derived IDs
+    /// are created from
+    bool compactIDs = false;
+
+    /// Declare edges that occur multiple times in the same graph only once.
+    /// Edges are coalesced in the order of their first occurrence. Equal edges
+    /// in different graphs are not coalesced
+    EdgeCoalescing coalesceEdges = EdgeCoalescing::None;
+
+    /// If `compactIDs` is set and this is not null, the mapping from compact
+    /// names to raw IDs is written to this sink, one `name raw-id` pair per
+    /// line
+    Sink* idMapping = nullptr;
+
+    /// Cache the generated code of each graph in the graph and reuse it while
+    /// the graph is unchanged. Setters and `Graph::add()` mark the enclosing
+    /// graphs dirty, so regenerating after a small edit only generates the
+    /// changed subgraphs again. Generated labels in clean subgraphs are not
+    /// evaluated again. The code of graphs attached with `Graph::addShared()`
+    /// is cached in the shared graph and reused in every graph it is attached
+    /// to where the enclosing scopes match. Has no effect if `compactIDs` is
+    /// set, because compact names depend on the whole graph. The same graph
+    /// must not be generated incrementally by multiple threads at once
+    bool incremental = false;
+
+    /// If not null, statistics of the call are written to this structure
+    GenerateStats* stats = nullptr;
+
+    /// If not null, this observer is notified of every scope
+    GenerateObserver* observer = nullptr;
+
+    /// If not null, code is generated for `reduce(graph, *reduce)` instead of
+    /// the graph itself. The reduced copy is discarded afterwards, so this
+    /// disables `incremental`
+    ReduceOptions const* reduce = nullptr;
+};
+
+/// Output formats of `generate()`
+enum class Format {
+    /// Graphviz DOT code
+    Dot,
+
+    /// JSON in the element format of Cytoscape.js. Subgraphs are compound
+    /// nodes, i.e. vertices refer to their subgraph as `parent`
+    Json,
+
+    /// GraphML. Subgraphs are nodes with a nested graph
+    GraphML,
+};
+
+/// Generates code in the format \p F for the graph \p graph and writes it to
+/// \p sink. The format is selected at compile time, and each format has its
+/// own instantiation of the traversal with the formatting inlined:
+/// ```
+///  generate<Format::Json>(graph, sink);
+/// ```
+/// Parallel and incremental generation and `hoistDefaults` are specific to
+/// DOT and are ignored by the other formats
+template <Format F>
+GRAPHGEN_API void generate(Graph const& graph,
+                           Sink& sink,
+                           GenerateOptions const& options = {});
+
+/// \overload for writing the generated code to \p ostream
+template <Format F>
+GRAPHGEN_API void generate(Graph const& graph,
+                           std::ostream& ostream,
+                           GenerateOptions const& options = {});
+
+/// Generate graphviz code for the graph \p graph and write it to \p sink
+GRAPHGEN_API void generate(Graph const& graph,
+                           Sink& sink,
+                           GenerateOptions const& options = {});
+
+/// \overload for writing the generated code to \p ostream
+GRAPHGEN_API void generate(Graph const& graph,
+                           std::ostream& ostream,
+                           GenerateOptions const& options = {});
 
 /// \overload for writing the generated code to `std::cout`
 GRAPHGEN_API void generate(Graph const& graph);
 
+/// Default number of bytes buffered by `generateAsync()`
+inline constexpr size_t DefaultAsyncMemoryBudget = size_t(4) << 20;
+
+/// Generates code for \p graph on a background thread and writes it to the
+/// file at \p path. Formatting and writing overlap through an `AsyncFileSink`
+/// that buffers at most \p memoryBudget bytes; if the disk falls behind, the
+/// generator waits for it. All errors, including failure to open the file,
+/// are reported through the returned future. \p graph and the objects that
+/// \p options point to must not be modified or destroyed until the future is
+/// ready
+GRAPHGEN_API std::future<void> generateAsync(
+    Graph const& graph,
+    std::filesystem::path path,
+    GenerateOptions const& options = {},
+    size_t memoryBudget = DefaultAsyncMemoryBudget);
+
+/// \overload for writing to the file descriptor \p fd which must stay open
+/// until the future is ready
+GRAPHGEN_API std::future<void> generateAsync(
+    Graph const& graph,
+    int fd,
+    GenerateOptions const& options = {},
+    size_t memoryBudget = DefaultAsyncMemoryBudget);
+
+/// Default maximum number of files `generateBatch()` writes at once
+inline constexpr size_t DefaultBatchMaxOpenFiles = 64;
+
+/// Outcome of generating one graph of `generateBatch()`
+struct BatchResult {
+    /// The path returned by the path function
+    std::filesystem::path path;
+
+    /// The exception thrown while the path was computed, the file was opened
+    /// or the graph was generated or written, null on success. The file may be
+    /// incomplete if this is set
+    std::exception_ptr error;
+
+    /// \Returns `true` if the graph has been written
+    bool ok() const { return !error; }
+};
+
+/// Generates code in the format \p F for each graph in \p graphs and writes
+/// it to the file at `pathFn(graph, index)`. Graphs are spread over
+/// `options.threads` threads including the calling thread and each graph is
+/// generated on a single thread. Every thread writes one file at a time
+/// through a `FileSink`, and at most \p maxOpenFiles threads are used, so
+/// that many files are open at once. A failure does not stop the batch, it
+/// is recorded in the result of the graph. \Returns one result per graph in
+/// the order of \p graphs. \p pathFn may be called concurrently.
+/// `options.stats`, `options.observer`, `options.idMapping` and the `stats` of
+/// `options.reduce` are not used, because they would be shared by concurrent
+/// generations
+template <Format F = Format::Dot>
+GRAPHGEN_API std::vector<BatchResult> generateBatch(
+    std::span<Graph const* const> graphs,
+    std::function<std::filesystem::path(Graph const&, size_t)> const& pathFn,
+    GenerateOptions const& options = {},
+    size_t maxOpenFiles = DefaultBatchMaxOpenFiles);
+
 } // namespace graphgen
 
 #endif // GRAPHGEN_GENERATE_H_
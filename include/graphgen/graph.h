@@ -1,6 +1,7 @@
 #ifndef GRAPHGEN_GRAPH_H_
 #define GRAPHGEN_GRAPH_H_
 
+#include <filesystem>
 #include <functional>
 #include <iosfwd>
 #include <memory>
@@ -8,9 +9,13 @@
 #include <ranges>
 #include <span>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
 #include <graphgen/api.h>
+#include <graphgen/arena.h>
+#include <graphgen/intern.h>
 #include <graphgen/style.h>
 
 namespace graphgen {
@@ -18,6 +23,13 @@ namespace graphgen {
 class Vertex;
 class Graph;
 class VertexVisitor;
+class OutputCache;
+struct CachedOutput;
+class ConcurrentGraphBuilder;
+class VertexIndex;
+class Sink;
+struct SpillSegment;
+struct SpillState;
 
 /// Vertex identifier. This is used to identify vertices when declaring edges
 class GRAPHGEN_API ID {
@@ -48,35 +60,117 @@ private:
 
 /// Different kinds of labels
 /// - `PlainText` is the default. When this option is used, double quotes `"`
-///   will be added around the label in the generated graphviz code
+///   will be added around the label in the generated graphviz code. Quotes and
+///   backslashes in the text are escaped and newlines are written as `\n`.
+///   Text that already contains escapes like `\"` or `\n` is escaped again
+///   and renders with the backslashes, use `Escaped` for such text
 /// - `HTML` When this option is used, `<` and `>` will be inserted around the
-///   label in the generated code
-enum class LabelKind { PlainText, HTML };
+///   label in the generated code. The text is written as is, so `<` and `>`
+///   in it must be balanced. Only `validate()` checks this, generation writes
+///   unbalanced text unchanged and graphviz rejects the output
+/// - `Escaped` The text is already escaped for a quoted graphviz string and
+///   may contain escape sequences such as `\l` or `\N`. It is written between
+///   double quotes as is and passed to other formats unchanged. The DOT
+///   reader uses this for labels with escape sequences that have no plain
+///   text equivalent
+enum class LabelKind : unsigned char { PlainText, HTML, Escaped };
 
 /// Represents a label of a vertex.
+/// Short text is stored inline, longer text in a single heap allocation.
+/// `Label::view()` refers to caller owned text without copying and callback
+/// labels are an opt-in for text that is generated on emission.
+/// Plain text labels, including the output of callbacks, are escaped when
+/// they are emitted. Earlier versions wrote them as is, so callers that
+/// escaped their text themselves must stop doing so or use
+/// `LabelKind::Escaped`
 class GRAPHGEN_API Label {
 public:
-    /// Constructs a label from \p text with label kind \p kind
-    Label(std::string text = {}, LabelKind kind = LabelKind::PlainText);
+    /// Signature of label callbacks
+    using Generator = std::function<void(std::ostream&)>;
 
-    ///
-    Label(std::function<void(std::ostream&)> generator,
-          LabelKind kind = LabelKind::PlainText);
+    /// Constructs an empty label
+    Label(): Label(std::string_view{}) {}
+
+    /// Constructs a label from a copy of \p text with label kind \p kind
+    Label(std::string_view text, LabelKind kind = LabelKind::PlainText);
+
+    /// Constructs a label that is generated by calling \p generator when the
+    /// graph is emitted
+    Label(Generator generator, LabelKind kind = LabelKind::PlainText);
+
+    /// Constructs a label that refers to \p text without copying it. The
+    /// caller must keep the text alive as long as the label is used
+    static Label view(std::string_view text,
+                      LabelKind kind = LabelKind::PlainText);
+
+    Label(Label const& rhs);
+
+    Label(Label&& rhs) noexcept;
+
+    Label& operator=(Label const& rhs);
+
+    Label& operator=(Label&& rhs) noexcept;
+
+    ~Label();
 
     /// \Returns The kind of the label
     LabelKind kind() const { return _kind; }
 
+    /// \Returns `true` if the label is generated by a callback
+    bool isGenerated() const { return _storage == Storage::Generator; }
+
+    /// \Returns the text of the label. Must not be called for generated
+    /// labels
+    std::string_view text() const {
+        return { _storage == Storage::Inline ? _inline : _text, _size };
+    }
+
+    /// Writes the text of the label without delimiters to \p sink. Generated
+    /// labels invoke their generator
+    void writeText(Sink& sink) const;
+
+    /// \Returns the number of bytes the label has allocated on the heap
+    size_t heapSize() const {
+        switch (_storage) {
+        case Storage::Owned:
+            return _size;
+        case Storage::Generator:
+            return sizeof(Generator);
+        default:
+            return 0;
+        }
+    }
+
     /// Writes the label to \p ostream
     friend std::ostream& operator<<(std::ostream& ostream, Label const& label) {
         label.emit(ostream);
         return ostream;
     }
 
+    /// Writes the label to \p sink
+    friend Sink& operator<<(Sink& sink, Label const& label) {
+        label.emit(sink);
+        return sink;
+    }
+
 private:
-    void emit(std::ostream& str) const;
+    enum class Storage : unsigned char { Inline, Owned, View, Generator };
 
-    std::function<void(std::ostream&)> generator;
+    static constexpr size_t InlineCapacity = 16;
+
+    void emit(std::ostream& str) const;
+    void emit(Sink& sink) const;
+    void copyFrom(Label const& rhs);
+    void destroy();
+
+    union {
+        char _inline[InlineCapacity];
+        char const* _text;
+        Generator* _generator;
+    };
+    uint32_t _size = 0;
     LabelKind _kind;
+    Storage _storage;
 };
 
 /// Different shapes of vertices
@@ -88,14 +182,16 @@ class VertexMixin {
 public:
     /// Allocates a vertex with ID \p id with `new` and returns it
     /// This can be passed directly to the parent graph which takes ownership
+    /// For large graphs prefer `Graph::emplace()` which avoids one heap
+    /// allocation per vertex
     static D* make(ID id) { return new D(id); }
 
     /// \Returns the label of the vertex
     Label const& label() const { return derived()->_label; }
 
     /// Set the label of this vertex to \p text
-    D* label(std::string text, LabelKind kind = LabelKind::PlainText) {
-        return label(Label(std::move(text), kind));
+    D* label(std::string_view text, LabelKind kind = LabelKind::PlainText) {
+        return label(Label(text, kind));
     }
 
     /// \overload
@@ -106,7 +202,9 @@ public:
 
     /// \overload
     D* label(Label label) {
+        derived()->willChange();
         derived()->_label = std::move(label);
+        derived()->markDirty();
         return derived();
     }
 
@@ -116,16 +214,28 @@ public:
     /// Set the shape of this vertex the default shape of all child vertices if
     /// this vertex is a graph
     D* shape(VertexShape shape) {
+        derived()->willChange();
         derived()->_shape = shape;
+        derived()->markDirty();
         return derived();
     }
 
     /// \Returns the font used for the vertex if overriden
-    std::optional<std::string> font() const { return derived()->_font; }
+    std::optional<std::string_view> font() const {
+        if (!derived()->_font) {
+            return std::nullopt;
+        }
+        return derived()->_font.view();
+    }
 
-    /// Override the font used for this vertex
-    D* font(std::optional<std::string> fontname) {
-        derived()->_font = std::move(fontname);
+    /// Override the font used for this vertex. Font names are interned in the
+    /// string pool of the tree the vertex belongs to, see `Graph::intern()`,
+    /// so vertices only store a handle. Vertices that are not part of a graph
+    /// yet keep a copy until they are added
+    D* font(std::optional<std::string_view> fontname) {
+        derived()->willChange();
+        derived()->setFont(fontname);
+        derived()->markDirty();
         return derived();
     }
 
@@ -134,7 +244,9 @@ public:
 
     /// Override the color used for this vertex
     D* color(std::optional<Color> color) {
+        derived()->willChange();
         derived()->_color = color;
+        derived()->markDirty();
         return derived();
     }
 
@@ -143,7 +255,9 @@ public:
 
     /// Override the style attribute used for this vertex
     D* style(std::optional<Style> style) {
+        derived()->willChange();
         derived()->_style = style;
+        derived()->markDirty();
         return derived();
     }
 
@@ -160,6 +274,10 @@ private:
     using Type::color;                                                         \
     using Type::style;
 
+/// Dynamic type of a vertex. Traversals dispatch on this tag instead of
+/// virtual calls or `dynamic_cast`
+enum class VertexKind : unsigned char { Vertex, Graph };
+
 /// Represents a vertex in the graph
 class GRAPHGEN_API Vertex: public VertexMixin<Vertex> {
     template <typename>
@@ -170,11 +288,27 @@ public:
 
     Vertex(ID id): _id(id) {}
 
-    virtual ~Vertex() = default;
+    Vertex(Vertex const&) = delete;
+
+    Vertex& operator=(Vertex const&) = delete;
+
+    virtual ~Vertex();
 
     /// \Returns the ID of the vertex
     ID id() const { return _id; }
 
+    /// \Returns the dynamic type of the vertex
+    VertexKind vertexKind() const { return _vertexKind; }
+
+    /// \Returns `true` if this vertex is a `Graph`
+    bool isGraph() const { return _vertexKind == VertexKind::Graph; }
+
+    /// \Returns this vertex as a graph or null if it is not a graph
+    Graph* asGraph();
+
+    /// \overload for const
+    Graph const* asGraph() const;
+
     /// \Returns the parent vertex in the graph
     Vertex* parent() { return _parent; }
 
@@ -184,15 +318,55 @@ public:
     /// Visitor pattern. This is actually an implementation detail
     virtual void visit(VertexVisitor& visitor) const;
 
+protected:
+    Vertex(ID id, VertexKind kind): _id(id), _vertexKind(kind) {}
+
 private:
     friend class Graph;
+    friend class OutputCache;
+    friend class ConcurrentGraphBuilder;
     void setParent(Vertex* parent) { _parent = parent; }
 
+    /// Marks this vertex as allocated in an arena. \p V is its dynamic type
+    template <typename V>
+    void setArenaAllocated() {
+        _arenaAllocated = true;
+        _plainVertex = std::is_same_v<V, Vertex>;
+    }
+
+    /// \Returns `true` if the destructor of this vertex has nothing to
+    /// release, so arena allocated vertices can be dropped without calling it
+    bool hasTrivialTeardown() const {
+        return _plainVertex && !_ownsFont && _label.heapSize() == 0;
+    }
+
+    /// Called by setters before the vertex is changed. `Graph` hides this
+    void willChange() {}
+
+    /// Sets the font to a handle of \p font in the string pool of the tree
+    /// this vertex belongs to or to a private copy if there is no tree yet
+    void setFont(std::optional<std::string_view> font);
+
+    /// Marks this vertex and all enclosing graphs as dirty. A dirty graph
+    /// implies dirty ancestors, so this stops at the first dirty ancestor.
+    /// The flag is only meaningful for graphs
+    void markDirty() {
+        _dirty = true;
+        for (Vertex* v = _parent; v && !v->_dirty; v = v->_parent) {
+            v->_dirty = true;
+        }
+    }
+
     Vertex* _parent = nullptr;
     ID _id;
     Label _label;
     VertexShape _shape{};
-    std::optional<std::string> _font;
+    VertexKind _vertexKind = VertexKind::Vertex;
+    bool _arenaAllocated = false;
+    bool _plainVertex = false;
+    mutable bool _dirty = true;
+    bool _ownsFont = false;
+    InternedString _font;
     std::optional<Color> _color;
     std::optional<Style> _style;
 };
@@ -213,6 +387,113 @@ struct Edge {
     std::optional<Style> style = {};
 };
 
+/// Attributes of the edge with index `index` in a graph. Graphs only store
+/// these for edges that have at least one attribute set
+struct EdgeAttributes {
+    size_t index;
+    std::optional<Color> color;
+    std::optional<Style> style;
+};
+
+/// View over the edges of a graph. Edges are stored as separate arrays of
+/// start and end IDs and a sparse array of attributes, so iteration produces
+/// `Edge` objects by value
+class EdgeView {
+public:
+    class Iterator {
+    public:
+        using value_type = Edge;
+        using difference_type = std::ptrdiff_t;
+        using iterator_concept = std::forward_iterator_tag;
+
+        Iterator() = default;
+
+        Edge operator*() const {
+            Edge edge{ from[index], to[index] };
+            if (attr != attrEnd && attr->index == index) {
+                edge.color = attr->color;
+                edge.style = attr->style;
+            }
+            return edge;
+        }
+
+        Iterator& operator++() {
+            if (attr != attrEnd && attr->index == index) {
+                ++attr;
+            }
+            ++index;
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            auto result = *this;
+            ++*this;
+            return result;
+        }
+
+        bool operator==(Iterator const& rhs) const {
+            return index == rhs.index;
+        }
+
+    private:
+        friend class EdgeView;
+
+        Iterator(EdgeView const& view, size_t index, size_t attrIndex):
+            from(view._from),
+            to(view._to),
+            attr(view._attributes + attrIndex),
+            attrEnd(view._attributes + view._numAttributes),
+            index(index) {}
+
+        ID const* from = nullptr;
+        ID const* to = nullptr;
+        EdgeAttributes const* attr = nullptr;
+        EdgeAttributes const* attrEnd = nullptr;
+        size_t index = 0;
+    };
+
+    EdgeView() = default;
+
+    EdgeView(ID const* from,
+             ID const* to,
+             size_t size,
+             EdgeAttributes const* attributes,
+             size_t numAttributes):
+        _from(from),
+        _to(to),
+        _size(size),
+        _attributes(attributes),
+        _numAttributes(numAttributes) {}
+
+    Iterator begin() const { return Iterator(*this, 0, 0); }
+
+    Iterator end() const { return Iterator(*this, _size, _numAttributes); }
+
+    /// \Returns the number of edges
+    size_t size() const { return _size; }
+
+    /// \Returns `true` if there are no edges
+    bool empty() const { return _size == 0; }
+
+    /// \Returns the IDs of the start vertices
+    std::span<ID const> from() const { return { _from, _size }; }
+
+    /// \Returns the IDs of the end vertices
+    std::span<ID const> to() const { return { _to, _size }; }
+
+    /// \Returns the attributes of all edges with attributes ordered by index
+    std::span<EdgeAttributes const> attributes() const {
+        return { _attributes, _numAttributes };
+    }
+
+private:
+    ID const* _from = nullptr;
+    ID const* _to = nullptr;
+    size_t _size = 0;
+    EdgeAttributes const* _attributes = nullptr;
+    size_t _numAttributes = 0;
+};
+
 /// Different kinds of graphs
 /// `Tree` is not supported yet
 enum class GraphKind { Directed, Undirected, Tree };
@@ -226,9 +507,24 @@ class GRAPHGEN_API Graph: public Vertex, public VertexMixin<Graph> {
 public:
     GRAPHGEN_USE_MIXIN(VertexMixin<Graph>)
 
-    using Vertex::Vertex;
+    /// Constructs a graph with ID \p id
+    Graph(ID id);
 
-    Graph(): Vertex(ID(this)) {}
+    /// Constructs a graph whose ID is derived from its address
+    Graph();
+
+    Graph(Graph const&) = delete;
+
+    Graph& operator=(Graph const&) = delete;
+
+    /// Destroys all child vertices. Memory of arena allocated vertices is
+    /// released in bulk by the owning arena. Emplaced plain vertices whose
+    /// label is stored inline or as a view and whose font is interned are
+    /// dropped without running their destructor, so for them only the
+    /// vertex lists are walked. Subgraphs, vertices of derived types, owned
+    /// or generated labels and vertices allocated with `new` are destroyed
+    /// one by one
+    ~Graph();
 
     /// Adds \p vertex to the graph
     /// This function expects the pointer to be allocated with `new` and will
@@ -237,26 +533,123 @@ public:
     ///  graph.add(new Vertex(...));
     /// ```
     Graph* add(Vertex* vertex) {
-        _vertices.push_back(std::unique_ptr<Vertex>(vertex));
+        willChange();
+        _vertices.push_back(vertex);
         vertex->setParent(this);
+        registerVertex(vertex);
+        markDirty();
         return this;
     }
 
+    /// Constructs a vertex of type \p V from \p args in memory owned by the
+    /// graph and adds it to this graph. All vertices emplaced into a graph tree
+    /// share the arena of the root graph, so allocation is a pointer bump and
+    /// freeing the memory is O(number of chunks). See `~Graph()` for which
+    /// destructors still run. Subgraphs that own an
+    /// arena, see `memoryBudget()`, allocate their vertices from their own
+    /// arena. Returns the new vertex for chaining:
+    /// ```
+    ///  graph.emplace<Vertex>(1)->label("A");
+    /// ```
+    template <typename V = Vertex, typename... Args>
+    V* emplace(Args&&... args) {
+        static_assert(std::is_base_of_v<Vertex, V>);
+        V* vertex = arena().create<V>(std::forward<Args>(args)...);
+        vertex->template setArenaAllocated<V>();
+        add(vertex);
+        return vertex;
+    }
+
     /// \overload for `unique_ptr<Vertex>`
     Graph* add(std::unique_ptr<Vertex> vertex) { return add(vertex.release()); }
 
+    /// Attaches \p graph as a subgraph of this graph without copying it. The
+    /// same graph can be attached to graphs of any number of trees and stays
+    /// alive as long as it is attached anywhere. \p graph must be a root and
+    /// must not be changed anymore. It must not be attached twice in the same
+    /// tree, because its vertices would have duplicate IDs. This is asserted
+    /// if the tree already contains its ID and reported by `validate()` if two
+    /// trees that both contain it are joined. \Returns the new subgraph, which
+    /// has the ID and attributes of \p graph and refers to its vertices and
+    /// edges. Changing the new subgraph first gives it a private copy of them,
+    /// see `unshare()`. In incremental mode the generated code of \p graph is
+    /// cached in \p graph and reused by all subgraphs that refer to it
+    /// wherever the enclosing scopes match
+    Graph* addShared(std::shared_ptr<Graph const> graph);
+
+    /// \Returns the graph whose vertices and edges this graph refers to or
+    /// null if it has its own
+    Graph const* sharedGraph() const { return _shared.get(); }
+
+    /// Replaces the vertices and edges this graph refers to by a private copy
+    /// and releases the shared graph. Setters and `add()` do this implicitly,
+    /// so changes never affect the other graphs the shared graph is attached
+    /// to. Shared graphs nested in the shared graph stay shared. This is a
+    /// no-op if this graph has its own vertices and edges
+    Graph* unshare();
+
     /// Adds the edge \p edge to the graph
     Graph* add(Edge edge) {
-        _edges.push_back(edge);
+        willChange();
+        if (edge.color || edge.style) {
+            _edgeAttributes.push_back(
+                { _edgeFrom.size(), edge.color, edge.style });
+        }
+        _edgeFrom.push_back(edge.from);
+        _edgeTo.push_back(edge.to);
+        markDirty();
+        return this;
+    }
+
+    /// Adds all edges in \p edges to the graph
+    Graph* addEdges(std::span<Edge const> edges) {
+        reserveEdges(_edgeFrom.size() + edges.size());
+        for (auto& edge: edges) {
+            add(edge);
+        }
         return this;
     }
 
+    /// Reserves storage for a total of \p count edges
+    Graph* reserveEdges(size_t count) {
+        willChange();
+        _edgeFrom.reserve(count);
+        _edgeTo.reserve(count);
+        return this;
+    }
+
+    /// \Returns the vertex with ID \p id anywhere in the tree this graph
+    /// belongs to or null if there is none. Vertices are indexed by the root
+    /// graph as they are added, so this is an O(1) hash lookup
+    Vertex* find(ID id);
+
+    /// \overload for const
+    Vertex const* find(ID id) const;
+
+    /// \Returns the IDs that are used by more than one vertex in the tree this
+    /// graph belongs to
+    std::span<ID const> duplicateIDs() const;
+
+    /// \Returns a handle to a copy of \p text that is owned by the root of the
+    /// tree this graph belongs to. Equal strings share one copy. Strings that
+    /// were interned before a graph was added to another tree stay owned by
+    /// that graph. This can be used to create labels without per vertex
+    /// allocations:
+    /// ```
+    ///  vertex->label(Label::view(graph.intern(text)));
+    /// ```
+    InternedString intern(std::string_view text) {
+        return strings().intern(text);
+    }
+
     /// \Returns the kind of the graph
     GraphKind kind() const { return _kind; }
 
     /// Sets the kind of this graph to \p kind
     Graph* kind(GraphKind kind) {
+        willChange();
         _kind = kind;
+        markDirty();
         return this;
     }
 
@@ -265,32 +658,150 @@ public:
 
     /// Sets the rank direction of this graph
     Graph* rankdir(RankDir dir) {
+        willChange();
         _rankDir = dir;
+        markDirty();
         return this;
     }
 
     /// \Returns a view over the vertices of this graph
-    auto vertices() const {
-        return _vertices |
-               std::views::transform([](auto& ptr) { return ptr.get(); });
+    std::span<Vertex* const> vertices() const {
+        return _shared ? _shared->_vertices : _vertices;
     }
 
+    /// Limits the memory held by finished subgraphs of this graph to about
+    /// \p bytes. Subgraphs added after this call allocate from arenas of their
+    /// own. Once they are marked with `finish()` and the limit is exceeded,
+    /// the oldest finished subgraphs are written to an append-only temporary
+    /// file in \p directory, the system temporary directory by default, and
+    /// their vertices, edges and labels are released. `traverse()` based
+    /// passes such as `generate()` and `validate()` read them back one at a
+    /// time in declaration order, so graphs larger than memory can be
+    /// generated. Generated labels are evaluated when a subgraph is spilled.
+    /// The IDs of spilled vertices stay in the index of the root, which costs
+    /// a few dozen bytes per vertex. Trees with a memory budget on any graph
+    /// are always generated serially and not incrementally
+    Graph* memoryBudget(size_t bytes, std::filesystem::path directory = {});
+
+    /// \Returns the memory budget of this graph if one has been set
+    std::optional<size_t> memoryBudget() const;
+
+    /// \Returns `true` if any graph in the tree this graph belongs to has a
+    /// memory budget
+    bool hasMemoryBudgetInTree() const { return root()._budgetInTree; }
+
+    /// Marks this graph as finished. If the parent graph has a memory budget,
+    /// this graph may be spilled to disk from now on and must not be modified
+    /// anymore. Otherwise this has no effect
+    Graph* finish();
+
+    /// \Returns `true` if the contents of this graph have been spilled to
+    /// disk. A spilled graph keeps its ID and attributes but has no vertices
+    /// and edges. `find()` returns the spilled graph for the IDs of the
+    /// vertices that were inside of it
+    bool isSpilled() const { return _segment != nullptr; }
+
+    /// \Returns a copy of this spilled graph and its contents read back from
+    /// disk or null if this graph is not spilled. The copy reports the parent
+    /// of this graph as its parent, but it is not a vertex of that parent
+    std::unique_ptr<Graph> readSpilled() const;
+
+    /// \Returns `true` if this graph or anything in it has been changed since
+    /// the last incremental generation. See `GenerateOptions::incremental`
+    bool isDirty() const { return _dirty; }
+
     /// \Returns a view over the edges of this graph
-    std::span<Edge const> edges() const { return _edges; }
+    EdgeView edges() const {
+        if (_shared) {
+            return _shared->edges();
+        }
+        return EdgeView(_edgeFrom.data(),
+                        _edgeTo.data(),
+                        _edgeFrom.size(),
+                        _edgeAttributes.data(),
+                        _edgeAttributes.size());
+    }
 
     /// Visitor pattern
     void visit(VertexVisitor& visitor) const override;
 
 private:
+    template <typename>
+    friend class VertexMixin;
+    friend class Vertex;
+    friend class OutputCache;
+    friend class ConcurrentGraphBuilder;
+
+    /// Called before this graph is changed. Shared vertices and edges are
+    /// copied first
+    void willChange() {
+        if (_shared) {
+            unshare();
+        }
+    }
+
+    /// \Returns the arena of the nearest enclosing graph that owns one. This is
+    /// the root unless subgraphs have been given arenas of their own
+    Arena& arena();
+
+    /// \Returns the string pool of the root of the tree this graph belongs to
+    StringPool& strings();
+
+    /// \Returns the root of the tree this graph belongs to
+    Graph& root();
+
+    /// \overload for const
+    Graph const& root() const;
+
+    /// Adds \p vertex and all vertices below it to the index of the root
+    void registerVertex(Vertex* vertex);
+
+    /// Destroys all vertices below this graph. If \p index is not null, its
+    /// entries that refer to destroyed vertices are redirected to this graph
+    void releaseVertices(VertexIndex* index);
+
+    /// \Returns an estimate of the memory used by the vertices, edges and
+    /// labels below this graph
+    size_t footprint() const;
+
+    /// Writes the contents of this graph to the spill file of \p state and
+    /// releases them
+    void spill(SpillState& state);
+
     GraphKind _kind{};
     RankDir _rankDir{};
-    std::vector<std::unique_ptr<Vertex>> _vertices;
-    std::vector<Edge> _edges;
+    std::unique_ptr<Arena> _arena;
+    std::unique_ptr<StringPool> _strings;
+    std::vector<Vertex*> _vertices;
+    std::vector<ID> _edgeFrom;
+    std::vector<ID> _edgeTo;
+    std::vector<EdgeAttributes> _edgeAttributes;
+    std::unique_ptr<VertexIndex> _index;
+    mutable std::unique_ptr<CachedOutput> _cachedOutput;
+    std::unique_ptr<SpillState> _spill;
+    std::unique_ptr<SpillSegment> _segment;
+    std::shared_ptr<Graph const> _shared;
     bool _isSubgraph = false;
+    bool _isFinished = false;
+
+    /// Set on roots if a graph in the tree has a memory budget
+    bool _budgetInTree = false;
 };
 
+inline Graph* Vertex::asGraph() {
+    return isGraph() ? static_cast<Graph*>(this) : nullptr;
+}
+
+inline Graph const* Vertex::asGraph() const {
+    return isGraph() ? static_cast<Graph const*>(this) : nullptr;
+}
+
 } // namespace graphgen
 
+template <>
+inline constexpr bool std::ranges::enable_borrowed_range<graphgen::EdgeView> =
+    true;
+
 template <>
 struct std::hash<graphgen::ID> {
     std::size_t operator()(graphgen::ID id) const {
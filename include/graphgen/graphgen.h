@@ -1,8 +1,16 @@
 #ifndef GRAPHGEN_GRAPHGEN_H_
 #define GRAPHGEN_GRAPHGEN_H_
 
+#include <graphgen/builder.h>
 #include <graphgen/config.h>
 #include <graphgen/generate.h>
 #include <graphgen/graph.h>
+#include <graphgen/intern.h>
+#include <graphgen/reader.h>
+#include <graphgen/reduce.h>
+#include <graphgen/sink.h>
+#include <graphgen/snapshot.h>
+#include <graphgen/streaming.h>
+#include <graphgen/validate.h>
 
 #endif // GRAPHGEN_GRAPHGEN_H_
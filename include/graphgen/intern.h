@@ -0,0 +1,81 @@
+#ifndef GRAPHGEN_INTERN_H_
+#define GRAPHGEN_INTERN_H_
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string_view>
+#include <unordered_set>
+
+#include <graphgen/api.h>
+#include <graphgen/arena.h>
+
+namespace graphgen {
+
+/// Handle to a string owned by a `StringPool`. Handles are the size of a
+/// pointer and can be copied freely. Handles obtained from the same pool
+/// compare equal if and only if their strings are equal
+class InternedString {
+public:
+    /// Constructs a null handle which represents an unset value
+    InternedString() = default;
+
+    /// \Returns the text of the string
+    std::string_view view() const {
+        if (!_data) {
+            return {};
+        }
+        uint32_t size;
+        std::memcpy(&size, _data - sizeof(uint32_t), sizeof(uint32_t));
+        return { _data, size };
+    }
+
+    /// \Returns `view()`
+    operator std::string_view() const { return view(); }
+
+    /// \Returns `true` if the handle refers to a string
+    explicit operator bool() const { return _data != nullptr; }
+
+    bool operator==(InternedString const&) const = default;
+
+private:
+    friend class StringPool;
+
+    explicit InternedString(char const* data): _data(data) {}
+
+    char const* _data = nullptr;
+};
+
+/// Stores one copy of every distinct string added to it. Memory is allocated
+/// in bulk from an arena and released when the pool is destroyed. All member
+/// functions are thread safe
+class GRAPHGEN_API StringPool {
+public:
+    StringPool() = default;
+
+    StringPool(StringPool const&) = delete;
+
+    StringPool& operator=(StringPool const&) = delete;
+
+    /// \Returns the handle of \p text, adding it to the pool if necessary
+    InternedString intern(std::string_view text);
+
+    /// \Returns the number of distinct strings in the pool
+    size_t size() const;
+
+    /// \Returns a handle to a heap allocated copy of \p text that is not owned
+    /// by any pool. The copy must be released with `deallocate()`
+    static InternedString allocate(std::string_view text);
+
+    /// Releases a copy returned by `allocate()`
+    static void deallocate(InternedString string);
+
+private:
+    mutable std::mutex mutex;
+    Arena arena;
+    std::unordered_set<std::string_view> strings;
+};
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_INTERN_H_
@@ -0,0 +1,96 @@
+#ifndef GRAPHGEN_READER_H_
+#define GRAPHGEN_READER_H_
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <graphgen/api.h>
+#include <graphgen/graph.h>
+
+namespace graphgen {
+
+/// Thrown by the DOT reader if the input is not valid DOT code
+class GRAPHGEN_API DotSyntaxError: public std::runtime_error {
+public:
+    DotSyntaxError(std::string const& message, size_t line, size_t column);
+
+    /// \Returns the line of the error starting at 1
+    size_t line() const { return _line; }
+
+    /// \Returns the column of the error starting at 1
+    size_t column() const { return _column; }
+
+private:
+    size_t _line;
+    size_t _column;
+};
+
+/// A graph that has been read from DOT code. The reader understands the
+/// subset of DOT that graphgen generates and the common constructs emitted
+/// by other tools:
+/// - `graph`, `digraph` and `strict` graphs
+/// - Subgraphs and anonymous `{ ... }` blocks are read as nested `Graph`s.
+///   `subgraph cluster_<name>` is read as the graph `<name>`
+/// - Node, edge and graph attribute statements, including `node [...]` and
+///   `edge [...]` defaults, and edge chains `a -> b -> c`
+/// - The attributes `label`, `fontname`, `shape`, `color`, `style` and
+///   `rankdir`. Other attributes and unknown values are ignored
+///
+/// Vertices named `vertex_<n>` get the ID `n`, so generated code reads back
+/// into a graph with the original IDs. Other vertices and anonymous subgraphs
+/// are numbered in the order they appear, starting above the largest `n` of
+/// any `vertex_<n>` in the input. Their IDs are the same on every run, never
+/// collide with the IDs of `vertex_<n>` names and can be looked up with
+/// `id()`. The root graph has the ID 0 unless it is named `vertex_<n>`.
+/// Vertices that are only referenced by edges are added to the graph of the
+/// first such edge with their name as the label.
+///
+/// Labels refer to the input text without copying whenever possible, so the
+/// input must outlive the document. `load()` keeps the mapped file alive
+class GRAPHGEN_API DotDocument {
+public:
+    /// Memory maps the file at \p path and reads the graph from it. Throws
+    /// `std::system_error` if the file cannot be mapped and `DotSyntaxError`
+    /// if it is not valid DOT code
+    static DotDocument load(std::filesystem::path const& path);
+
+    /// Reads the graph from \p text without copying it. The caller must keep
+    /// \p text alive as long as the document is used
+    static DotDocument view(std::string_view text);
+
+    DotDocument(DotDocument&& rhs) noexcept;
+
+    DotDocument& operator=(DotDocument&& rhs) noexcept;
+
+    ~DotDocument();
+
+    /// \Returns the root graph
+    Graph& graph() { return *_graph; }
+
+    /// \overload for const
+    Graph const& graph() const { return *_graph; }
+
+    /// \Returns the ID of the vertex or subgraph named \p name in the input
+    std::optional<ID> id(std::string_view name) const;
+
+private:
+    struct Impl;
+
+    explicit DotDocument(std::unique_ptr<Impl> impl);
+
+    std::unique_ptr<Impl> _impl;
+    Graph* _graph;
+};
+
+/// Reads a graph from the DOT code \p text. Unlike `DotDocument` the returned
+/// graph does not refer to \p text
+GRAPHGEN_API std::unique_ptr<Graph> parseDot(std::string_view text);
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_READER_H_
@@ -0,0 +1,86 @@
+#ifndef GRAPHGEN_REDUCE_H_
+#define GRAPHGEN_REDUCE_H_
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+#include <graphgen/api.h>
+#include <graphgen/graph.h>
+
+namespace graphgen {
+
+/// Number of vertices and edges removed by `reduce()`
+struct ReduceStats {
+    /// Number of subgraphs replaced by a summary vertex
+    size_t collapsedGraphs = 0;
+
+    /// Number of vertices and nested subgraphs inside the collapsed subgraphs
+    size_t collapsedVertices = 0;
+
+    /// Number of edges that were removed because both endpoints were collapsed
+    /// into the same vertex or because they duplicated another edge after
+    /// their endpoints were collapsed
+    size_t collapsedEdges = 0;
+
+    /// Number of edges removed by the transitive reduction
+    size_t transitiveEdges = 0;
+
+    /// Number of edges dropped to respect `ReduceOptions::maxFanOut`
+    size_t fanOutEdges = 0;
+
+    /// `false` if the transitive reduction was requested but skipped because
+    /// the edges contain a cycle
+    bool acyclic = true;
+};
+
+/// Options of `reduce()`. All reductions are disabled by default
+struct ReduceOptions {
+    /// Subgraphs nested deeper than this are collapsed. The root has depth 0,
+    /// so a value of 0 collapses every subgraph of the root
+    std::optional<size_t> maxDepth;
+
+    /// Subgraphs with more than this many vertices, counting those in nested
+    /// subgraphs, are collapsed
+    std::optional<size_t> maxGraphSize;
+
+    /// Maximum number of edges that leave a vertex. Further edges are dropped
+    /// in declaration order. In undirected graphs the first endpoint of an
+    /// edge is the one it leaves
+    std::optional<size_t> maxFanOut;
+
+    /// Remove every edge `u -> w` for which `w` is reachable from `u` through
+    /// other edges. Only applies to directed graphs and is skipped if the
+    /// edges contain a cycle. Edges with a color or style are never removed,
+    /// because the other path would not show their attributes, but they can
+    /// imply other edges. Parallel edges without attributes are merged
+    bool transitiveReduction = false;
+
+    /// Exact transitive reduction takes quadratic time on dense graphs, so the
+    /// search for alternative paths examines at most this many edges per
+    /// vertex. Redundant edges that are not found within the limit are kept
+    size_t transitiveSearchLimit = 4096;
+
+    /// If not null, the number of removed vertices and edges is written here
+    ReduceStats* stats = nullptr;
+};
+
+/// \Returns a copy of \p graph with the reductions of \p options applied. This
+/// is meant to bound the time graphviz spends on the layout of very large
+/// graphs:
+/// - Subgraphs beyond `maxDepth` or `maxGraphSize` are replaced by a single
+///   vertex with the ID, label and attributes of the subgraph. Edges to
+///   vertices inside the subgraph are redirected to that vertex
+/// - Edges implied by other paths are removed if `transitiveReduction` is set
+/// - At most `maxFanOut` edges leave each vertex
+///
+/// What a reduction removed is appended to the label of the affected vertex,
+/// e.g. `[collapsed 120 vertices, 310 edges]`. All passes run in time linear
+/// in the size of the graph, the transitive reduction in
+/// O(E + V * transitiveSearchLimit)
+GRAPHGEN_API std::unique_ptr<Graph> reduce(Graph const& graph,
+                                           ReduceOptions const& options = {});
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_REDUCE_H_
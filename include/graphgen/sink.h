@@ -0,0 +1,270 @@
+#ifndef GRAPHGEN_SINK_H_
+#define GRAPHGEN_SINK_H_
+
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <graphgen/api.h>
+
+namespace graphgen {
+
+/// Destination of generated code. A sink exposes a contiguous buffer that is
+/// filled directly by the generator. Derived classes decide what happens when
+/// the buffer is full by implementing `overflow()`
+class GRAPHGEN_API Sink {
+public:
+    Sink();
+
+    Sink(Sink const&) = delete;
+
+    Sink& operator=(Sink const&) = delete;
+
+    virtual ~Sink();
+
+    /// Appends \p text to the sink
+    void write(std::string_view text) {
+        if (text.size() <= available()) {
+            std::memcpy(_current, text.data(), text.size());
+            _current += text.size();
+            return;
+        }
+        writeSlow(text);
+    }
+
+    /// Appends the character \p c to the sink
+    void put(char c) {
+        if (_current == _end) {
+            overflow(1);
+        }
+        *_current++ = c;
+    }
+
+    /// Appends the decimal representation of \p value to the sink
+    template <std::integral T>
+    void writeNumber(T value) {
+        char* begin = reserve(MaxDigits);
+        _current = std::to_chars(begin, _end, value).ptr;
+    }
+
+    /// Passes all buffered data on to the destination
+    virtual void flush() {}
+
+    /// \Returns a `std::ostream` that writes into this sink. This exists to
+    /// support user callbacks that expect a stream
+    std::ostream& ostream();
+
+    /// \Returns the total number of bytes written to this sink
+    std::size_t bytesWritten() const {
+        return _flushed + static_cast<std::size_t>(_current - _begin);
+    }
+
+    friend Sink& operator<<(Sink& sink, std::string_view text) {
+        sink.write(text);
+        return sink;
+    }
+
+    friend Sink& operator<<(Sink& sink, char const* text) {
+        sink.write(text);
+        return sink;
+    }
+
+    friend Sink& operator<<(Sink& sink, char c) {
+        sink.put(c);
+        return sink;
+    }
+
+    template <std::integral T>
+    friend Sink& operator<<(Sink& sink, T value) {
+        sink.writeNumber(value);
+        return sink;
+    }
+
+protected:
+    /// Called when fewer than \p size bytes are available. Implementations
+    /// must call `setBuffer()` to make at least \p size bytes available
+    virtual void overflow(std::size_t size) = 0;
+
+    /// Sets the buffer to the range `[begin, end)` with the write position at
+    /// \p current
+    void setBuffer(char* begin, char* current, char* end) {
+        _begin = begin;
+        _current = current;
+        _end = end;
+    }
+
+    /// Must be called by derived classes when they passed the buffered data
+    /// on and reset the buffer
+    void noteFlushed(std::size_t size) { _flushed += size; }
+
+    char* bufferBegin() const { return _begin; }
+
+    char* bufferCurrent() const { return _current; }
+
+    char* bufferEnd() const { return _end; }
+
+    std::size_t available() const {
+        return static_cast<std::size_t>(_end - _current);
+    }
+
+private:
+    static constexpr std::size_t MaxDigits = 24;
+
+    struct StreamAdapter;
+
+    char* reserve(std::size_t size) {
+        if (available() < size) {
+            overflow(size);
+        }
+        return _current;
+    }
+
+    void writeSlow(std::string_view text);
+
+    char* _begin = nullptr;
+    char* _current = nullptr;
+    char* _end = nullptr;
+    std::size_t _flushed = 0;
+    std::unique_ptr<StreamAdapter> _stream;
+};
+
+/// Sink that writes into a contiguous growable in-memory buffer
+class GRAPHGEN_API BufferSink: public Sink {
+public:
+    explicit BufferSink(std::size_t initialCapacity = 0);
+
+    /// \Returns a view over the written data
+    std::string_view view() const {
+        return { bufferBegin(), size() };
+    }
+
+    /// \Returns a copy of the written data
+    std::string str() const { return std::string(view()); }
+
+    /// \Returns the number of bytes in the buffer
+    std::size_t size() const {
+        return static_cast<std::size_t>(bufferCurrent() - bufferBegin());
+    }
+
+    /// Discards the written data but keeps the capacity
+    void clear();
+
+private:
+    void overflow(std::size_t size) override;
+
+    std::vector<char> _buffer;
+};
+
+/// Sink that writes to a file descriptor in large blocks
+class GRAPHGEN_API FileSink: public Sink {
+public:
+    static constexpr std::size_t DefaultBlockSize = std::size_t(1) << 20;
+
+    /// Writes to the file descriptor \p fd which must be open for writing.
+    /// The sink does not take ownership of \p fd
+    explicit FileSink(int fd, std::size_t blockSize = DefaultBlockSize);
+
+    /// Creates or truncates the file at \p path and writes to it. Throws
+    /// `std::system_error` if the file cannot be opened
+    explicit FileSink(std::filesystem::path const& path,
+                      std::size_t blockSize = DefaultBlockSize);
+
+    /// Flushes remaining data and closes the file if it is owned by the sink
+    ~FileSink();
+
+    /// Writes all buffered data to the file descriptor. Throws
+    /// `std::system_error` on failure
+    void flush() override;
+
+    /// Flushes remaining data, closes the file if it is owned by the sink and
+    /// continues writing to the file at \p path, which is created or
+    /// truncated. The buffer is kept, so one sink can write many files without
+    /// allocating. Throws `std::system_error` on failure
+    void open(std::filesystem::path const& path);
+
+    /// \Returns the file descriptor
+    int fd() const { return _fd; }
+
+private:
+    void overflow(std::size_t size) override;
+
+    std::vector<char> _buffer;
+    int _fd;
+    bool _ownsFD;
+};
+
+/// Sink that overlaps generation with writing to a file descriptor. Data is
+/// collected in a ring of \p numBlocks blocks, and a writer thread owned by
+/// the sink writes full blocks while the next one is being filled. The memory
+/// used is bounded by `blockSize * numBlocks`. If all blocks are waiting to be
+/// written, the generator blocks until one becomes free
+class GRAPHGEN_API AsyncFileSink: public Sink {
+public:
+    static constexpr std::size_t DefaultNumBlocks = 4;
+
+    /// Writes to the file descriptor \p fd which must be open for writing.
+    /// The sink does not take ownership of \p fd
+    explicit AsyncFileSink(int fd,
+                           std::size_t blockSize = FileSink::DefaultBlockSize,
+                           std::size_t numBlocks = DefaultNumBlocks);
+
+    /// Creates or truncates the file at \p path and writes to it. Throws
+    /// `std::system_error` if the file cannot be opened
+    explicit AsyncFileSink(std::filesystem::path const& path,
+                           std::size_t blockSize = FileSink::DefaultBlockSize,
+                           std::size_t numBlocks = DefaultNumBlocks);
+
+    /// Writes remaining data, stops the writer thread and closes the file if
+    /// it is owned by the sink
+    ~AsyncFileSink();
+
+    /// Waits until all buffered data has been written. Throws
+    /// `std::system_error` if a write failed. Write errors are also thrown
+    /// when the generator waits for a free block
+    void flush() override;
+
+    /// \Returns the file descriptor
+    int fd() const { return _fd; }
+
+private:
+    struct Pipeline;
+
+    void overflow(std::size_t size) override;
+
+    void acquireBlock();
+
+    std::unique_ptr<Pipeline> _pipeline;
+    std::vector<char>* _block = nullptr;
+    int _fd;
+    bool _ownsFD;
+};
+
+/// Sink that passes data on to a `std::ostream` in large blocks
+class GRAPHGEN_API OStreamSink: public Sink {
+public:
+    explicit OStreamSink(std::ostream& ostream,
+                         std::size_t blockSize = std::size_t(64) << 10);
+
+    /// Flushes remaining data
+    ~OStreamSink();
+
+    /// Writes all buffered data to the stream
+    void flush() override;
+
+private:
+    void overflow(std::size_t size) override;
+
+    std::vector<char> _buffer;
+    std::ostream& _ostream;
+};
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_SINK_H_
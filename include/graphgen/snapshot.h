@@ -0,0 +1,265 @@
+#ifndef GRAPHGEN_SNAPSHOT_H_
+#define GRAPHGEN_SNAPSHOT_H_
+
+#include <cstddef>
+#include <filesystem>
+#include <iosfwd>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+
+#include <graphgen/api.h>
+#include <graphgen/generate.h>
+#include <graphgen/graph.h>
+
+namespace graphgen {
+
+class Sink;
+class Snapshot;
+class SnapshotGraph;
+
+/// Current version of the snapshot format. Snapshots of other versions are
+/// rejected by `Snapshot::load()`
+inline constexpr uint32_t SnapshotVersion = 1;
+
+/// Read-only view of a vertex in a snapshot. Views are cheap to copy and are
+/// valid as long as the snapshot is alive
+class GRAPHGEN_API SnapshotVertex {
+public:
+    /// \Returns the ID of the vertex
+    ID id() const;
+
+    /// \Returns the label of the vertex. The label refers to the text in the
+    /// snapshot without copying it
+    Label label() const;
+
+    /// \Returns the font used for the vertex if overriden
+    std::optional<std::string_view> font() const;
+
+    /// \Returns the shape of the vertex
+    VertexShape shape() const;
+
+    /// \Returns the color used for the vertex if overriden
+    std::optional<Color> color() const;
+
+    /// \Returns the style attribute used for the vertex if overriden
+    std::optional<Style> style() const;
+
+    /// \Returns `true` if this vertex is a graph
+    bool isGraph() const;
+
+    /// \Returns this vertex as a graph. Must only be called if `isGraph()`
+    SnapshotGraph asGraph() const;
+
+    /// Constructs a view of the vertex record at \p index in \p snapshot
+    SnapshotVertex(Snapshot const* snapshot, size_t index):
+        _snapshot(snapshot), _index(index) {}
+
+protected:
+    Snapshot const* _snapshot;
+    size_t _index;
+};
+
+/// Read-only view of a graph in a snapshot
+class GRAPHGEN_API SnapshotGraph: public SnapshotVertex {
+public:
+    /// Forward iterator over the direct children of a graph
+    class Iterator {
+    public:
+        using value_type = SnapshotVertex;
+        using difference_type = std::ptrdiff_t;
+        using iterator_concept = std::forward_iterator_tag;
+
+        Iterator() = default;
+
+        SnapshotVertex operator*() const { return { snapshot, index }; }
+
+        GRAPHGEN_API Iterator& operator++();
+
+        Iterator operator++(int) {
+            auto result = *this;
+            ++*this;
+            return result;
+        }
+
+        bool operator==(Iterator const& rhs) const {
+            return index == rhs.index;
+        }
+
+    private:
+        friend class SnapshotGraph;
+
+        Iterator(Snapshot const* snapshot, size_t index):
+            snapshot(snapshot), index(index) {}
+
+        Snapshot const* snapshot = nullptr;
+        size_t index = 0;
+    };
+
+    /// Range of the direct children of a graph
+    struct VertexRange {
+        Iterator begin() const { return first; }
+        Iterator end() const { return last; }
+
+        Iterator first, last;
+    };
+
+    /// Forward iterator over the edges of a graph. Yields `Edge` by value
+    class EdgeIterator {
+    public:
+        using value_type = Edge;
+        using difference_type = std::ptrdiff_t;
+        using iterator_concept = std::forward_iterator_tag;
+
+        EdgeIterator() = default;
+
+        GRAPHGEN_API Edge operator*() const;
+
+        EdgeIterator& operator++() {
+            ++index;
+            return *this;
+        }
+
+        EdgeIterator operator++(int) {
+            auto result = *this;
+            ++*this;
+            return result;
+        }
+
+        bool operator==(EdgeIterator const& rhs) const {
+            return index == rhs.index;
+        }
+
+    private:
+        friend class SnapshotGraph;
+
+        EdgeIterator(Snapshot const* snapshot, size_t index):
+            snapshot(snapshot), index(index) {}
+
+        Snapshot const* snapshot = nullptr;
+        size_t index = 0;
+    };
+
+    /// Range of the edges of a graph
+    struct EdgeRange {
+        EdgeIterator begin() const { return first; }
+        EdgeIterator end() const { return last; }
+
+        EdgeIterator first, last;
+    };
+
+    /// \Returns the kind of the graph
+    GraphKind kind() const;
+
+    /// \Returns the rank direction of the graph
+    RankDir rankdir() const;
+
+    /// \Returns `true` if this is the root graph of the snapshot
+    bool isRoot() const { return _index == 0; }
+
+    /// \Returns a view over the direct children of this graph
+    VertexRange vertices() const;
+
+    /// \Returns a view over the edges of this graph
+    EdgeRange edges() const;
+
+    using SnapshotVertex::SnapshotVertex;
+};
+
+/// A graph that has been saved with `saveSnapshot()` and loaded from memory.
+/// Vertices are stored in pre-order as fixed size records, so the snapshot can
+/// be used directly from a memory mapped file without parsing or allocating
+class GRAPHGEN_API Snapshot {
+public:
+    /// Maps the file at \p path into memory. Throws `std::system_error` if the
+    /// file cannot be mapped and `std::runtime_error` if it is not a valid
+    /// snapshot of version `SnapshotVersion`. Every record is checked against
+    /// the size of the file once, so truncated or corrupt files are rejected
+    /// and accessors do not need to check bounds
+    static Snapshot load(std::filesystem::path const& path);
+
+    /// Uses the snapshot in \p data without copying it. The caller must keep
+    /// \p data alive as long as the snapshot is used. The data must be aligned
+    /// to 8 bytes. Validated and throws like `load()`
+    static Snapshot view(std::span<char const> data);
+
+    Snapshot(Snapshot&& rhs) noexcept;
+
+    Snapshot& operator=(Snapshot&& rhs) noexcept;
+
+    ~Snapshot();
+
+    /// \Returns the saved graph
+    SnapshotGraph root() const { return SnapshotGraph(this, 0); }
+
+    /// \Returns the number of vertices including subgraphs and the root
+    size_t numVertices() const;
+
+    /// \Returns the total number of edges
+    size_t numEdges() const;
+
+    /// \Returns the raw data of the snapshot
+    std::span<char const> data() const { return { _data, _size }; }
+
+    /// Records of the file format. These are defined in the implementation
+    /// @{
+    struct Header;
+    struct NodeRecord;
+    struct EdgeRecord;
+    /// @}
+
+private:
+    friend class SnapshotVertex;
+    friend class SnapshotGraph;
+
+    friend class SnapshotGraph::Iterator;
+    friend class SnapshotGraph::EdgeIterator;
+
+    struct Mapping;
+
+    Snapshot(std::unique_ptr<Mapping> mapping,
+             char const* data,
+             size_t size);
+
+    void validate() const;
+
+    Header const& header() const;
+    NodeRecord const& node(size_t index) const;
+    EdgeRecord const& edge(size_t index) const;
+    std::string_view string(uint64_t offset, uint32_t size) const;
+
+    std::unique_ptr<Mapping> _mapping;
+    char const* _data;
+    size_t _size;
+};
+
+/// Writes a binary snapshot of \p graph to \p sink. Generated labels are
+/// evaluated and stored as text
+GRAPHGEN_API void saveSnapshot(Graph const& graph, Sink& sink);
+
+/// \overload for writing the snapshot to the file at \p path
+GRAPHGEN_API void saveSnapshot(Graph const& graph,
+                               std::filesystem::path const& path);
+
+/// Generate graphviz code for the snapshot \p snapshot and write it to \p sink.
+/// The output is identical to generating the graph the snapshot was saved from
+/// with the same options. Of \p options, `compactIDs`, `idMapping`,
+/// `coalesceEdges` and `stats` are used. The other options need a graph tree
+/// and are ignored: snapshots are always generated serially, without
+/// hoisting, reduction or validation, and `observer` is not notified.
+/// `GenerateStats::labelGeneratorTime` is zero because snapshots store the
+/// text of generated labels
+GRAPHGEN_API void generate(Snapshot const& snapshot,
+                           Sink& sink,
+                           GenerateOptions const& options = {});
+
+/// \overload for writing the generated code to \p ostream
+GRAPHGEN_API void generate(Snapshot const& snapshot,
+                           std::ostream& ostream,
+                           GenerateOptions const& options = {});
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_SNAPSHOT_H_
@@ -0,0 +1,117 @@
+#ifndef GRAPHGEN_STREAMING_H_
+#define GRAPHGEN_STREAMING_H_
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <graphgen/api.h>
+#include <graphgen/graph.h>
+
+namespace graphgen {
+
+class Sink;
+class DotWriter;
+
+/// Writes graphviz code directly to a sink while the graph is being declared,
+/// without materializing a `Graph` tree. Memory use is constant apart from the
+/// stack of open subgraphs.
+/// ```
+///  StreamingGraphWriter writer(sink);
+///  writer.beginGraph(0)->font("Helvetica");
+///  writer.vertex(1)->label("A");
+///  writer.beginSubgraph(2)->label("Sub");
+///  writer.vertex(3)->label("B")->shape(VertexShape::Circle);
+///  writer.endSubgraph();
+///  writer.edge({ 1, 3 });
+///  writer.endGraph();
+/// ```
+/// Attributes of a vertex or subgraph can be set through the returned element
+/// until the next call to the writer, at which point the element is written.
+/// Edges are written in the order they are added
+class GRAPHGEN_API StreamingGraphWriter {
+public:
+    /// The vertex or graph that has been declared last. Exposes the same
+    /// chaining setters as `Vertex` and `Graph`
+    class GRAPHGEN_API Element: public VertexMixin<Element> {
+        template <typename>
+        friend class VertexMixin;
+
+    public:
+        /// \Returns the rank direction of the element if it is a graph
+        RankDir rankdir() const { return _rankDir; }
+
+        /// Sets the rank direction. Only meaningful for graphs
+        Element* rankdir(RankDir dir) {
+            _rankDir = dir;
+            return this;
+        }
+
+    private:
+        friend class StreamingGraphWriter;
+
+        /// Elements are written once, so there is nothing to invalidate
+        void markDirty() {}
+
+        /// Elements are never shared, so there is nothing to copy
+        void willChange() {}
+
+        /// Interns \p font in the string pool of the writer, which keeps the
+        /// fonts of open graphs alive
+        void setFont(std::optional<std::string_view> font) {
+            _font = font ? _strings->intern(*font) : InternedString();
+        }
+
+        StringPool* _strings = nullptr;
+        Label _label;
+        VertexShape _shape{};
+        InternedString _font;
+        std::optional<Color> _color;
+        std::optional<Style> _style;
+        RankDir _rankDir{};
+    };
+
+    /// Constructs a writer that writes a graph of kind \p kind to \p sink
+    explicit StreamingGraphWriter(Sink& sink,
+                                  GraphKind kind = GraphKind::Directed);
+
+    ~StreamingGraphWriter();
+
+    /// Opens the root graph with ID \p id
+    Element* beginGraph(ID id = 0);
+
+    /// Closes the root graph and flushes the sink
+    void endGraph();
+
+    /// Opens a subgraph with ID \p id in the current graph
+    Element* beginSubgraph(ID id);
+
+    /// Closes the innermost subgraph
+    void endSubgraph();
+
+    /// Declares a vertex with ID \p id in the current graph
+    Element* vertex(ID id);
+
+    /// Declares the edge \p edge
+    void edge(Edge const& edge);
+
+    /// \Returns the number of currently open graphs
+    size_t depth() const;
+
+private:
+    enum class Pending { None, Graph, Vertex };
+
+    Element* declare(Pending kind, ID id);
+    void writePending();
+
+    std::unique_ptr<DotWriter> _writer;
+    std::unique_ptr<StringPool> _strings;
+    Pending _pending = Pending::None;
+    ID _pendingID = 0;
+    Element _element;
+};
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_STREAMING_H_
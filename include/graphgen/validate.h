@@ -0,0 +1,53 @@
+#ifndef GRAPHGEN_VALIDATE_H_
+#define GRAPHGEN_VALIDATE_H_
+
+#include <stdexcept>
+#include <vector>
+
+#include <graphgen/api.h>
+#include <graphgen/graph.h>
+
+namespace graphgen {
+
+/// Problems found by `validate()`
+struct ValidationResult {
+    /// IDs that are used by more than one vertex
+    std::vector<ID> duplicateIDs;
+
+    /// Edges where at least one endpoint is not a vertex of the graph. Edges
+    /// to subgraphs are included because graphviz would create a new vertex
+    /// for them too
+    std::vector<Edge> danglingEdges;
+
+    /// IDs of vertices and graphs with HTML labels in which `<` and `>` are
+    /// not balanced. Generated labels are not checked
+    std::vector<ID> malformedLabels;
+
+    /// \Returns `true` if no problems were found
+    bool ok() const {
+        return duplicateIDs.empty() && danglingEdges.empty() &&
+               malformedLabels.empty();
+    }
+};
+
+/// Checks that all vertex IDs in the tree of \p graph are unique, that all
+/// edges of \p graph and its subgraphs connect existing vertices and that HTML
+/// labels are balanced. This runs in O(V + E + size of HTML labels) using the
+/// vertex index of the graph
+GRAPHGEN_API ValidationResult validate(Graph const& graph);
+
+/// Thrown by `generate()` if validation is enabled and fails
+class GRAPHGEN_API InvalidGraphError: public std::runtime_error {
+public:
+    explicit InvalidGraphError(ValidationResult result);
+
+    /// \Returns the problems found in the graph
+    ValidationResult const& result() const { return _result; }
+
+private:
+    ValidationResult _result;
+};
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_VALIDATE_H_
@@ -0,0 +1,67 @@
+#include "graphgen/arena.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+using namespace graphgen;
+
+static constexpr std::size_t MinChunkSize = std::size_t(64) << 10;
+static constexpr std::size_t MaxChunkSize = std::size_t(4) << 20;
+
+struct Arena::Chunk {
+    Chunk* next;
+    std::size_t size;
+};
+
+Arena::~Arena() {
+    while (_head) {
+        Chunk* next = _head->next;
+        std::free(_head);
+        _head = next;
+    }
+}
+
+void Arena::absorb(Arena& other) {
+    if (!other._head) {
+        return;
+    }
+    // The current chunk stays at the head, so allocation continues in it
+    Chunk* tail = other._head;
+    while (tail->next) {
+        tail = tail->next;
+    }
+    if (_head) {
+        tail->next = _head->next;
+        _head->next = other._head;
+    }
+    else {
+        _head = other._head;
+        _current = other._current;
+        _end = other._end;
+    }
+    _numChunks += other._numChunks;
+    _capacity += other._capacity;
+    other._head = nullptr;
+    other._current = other._end = nullptr;
+    other._numChunks = other._capacity = 0;
+}
+
+void* Arena::allocateSlow(std::size_t size, std::size_t align) {
+    // Chunks grow geometrically so the number of chunks stays logarithmic in
+    // the total size. Oversized requests get a chunk of their own
+    std::size_t chunkSize = std::clamp(_capacity, MinChunkSize, MaxChunkSize);
+    std::size_t needed = sizeof(Chunk) + size + align;
+    chunkSize = std::max(chunkSize, needed);
+    auto* chunk = static_cast<Chunk*>(std::malloc(chunkSize));
+    if (!chunk) {
+        throw std::bad_alloc();
+    }
+    chunk->next = _head;
+    chunk->size = chunkSize;
+    _head = chunk;
+    ++_numChunks;
+    _capacity += chunkSize;
+    _current = reinterpret_cast<char*>(chunk + 1);
+    _end = reinterpret_cast<char*>(chunk) + chunkSize;
+    return allocate(size, align);
+}
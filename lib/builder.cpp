@@ -0,0 +1,169 @@
+#include "graphgen/builder.h"
+
+#include <array>
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+#include "idmap.h"
+#include "vertexindex.h"
+
+using namespace graphgen;
+
+namespace {
+
+/// Shards of the last few builders the thread has used, so threads that feed
+/// several builders alternately do not take the lock on every call. Builders
+/// are identified by a serial number instead of their address, so a new
+/// builder at the address of a destroyed one does not hit a stale entry
+struct ThreadCache {
+    struct Entry {
+        uint64_t serial = 0;
+        ConcurrentGraphBuilder::Shard* shard = nullptr;
+    };
+
+    static constexpr size_t Size = 4;
+
+    ConcurrentGraphBuilder::Shard* find(uint64_t serial) const {
+        for (auto& entry: entries) {
+            if (entry.serial == serial) {
+                return entry.shard;
+            }
+        }
+        return nullptr;
+    }
+
+    /// Replaces the oldest entry
+    void insert(uint64_t serial, ConcurrentGraphBuilder::Shard* shard) {
+        entries[next] = { serial, shard };
+        next = (next + 1) % Size;
+    }
+
+    std::array<Entry, Size> entries;
+    size_t next = 0;
+};
+
+/// Vertices and edges of one graph gathered from all shards
+struct Children {
+    std::vector<Vertex*> vertices;
+    std::vector<Edge> edges;
+};
+
+} // namespace
+
+static std::atomic<uint64_t> nextSerial = 1;
+
+static thread_local ThreadCache threadCache;
+
+ConcurrentGraphBuilder::Shard::~Shard() { clear(); }
+
+void ConcurrentGraphBuilder::Shard::clear() {
+    // Pending graphs have no children yet, so destroying each vertex on its
+    // own destroys everything exactly once
+    for (auto& [parent, bucket]: _buckets) {
+        for (auto* vertex: bucket.vertices) {
+            vertex->~Vertex();
+        }
+    }
+    _buckets.clear();
+    _last = nullptr;
+}
+
+ConcurrentGraphBuilder::ConcurrentGraphBuilder(ID rootID):
+    _rootID(rootID), _serial(nextSerial.fetch_add(1)) {}
+
+ConcurrentGraphBuilder::~ConcurrentGraphBuilder() = default;
+
+ConcurrentGraphBuilder::Shard& ConcurrentGraphBuilder::shard() {
+    if (auto* shard = threadCache.find(_serial)) {
+        return *shard;
+    }
+    std::lock_guard lock(_mutex);
+    auto& shard = _threadShards[std::this_thread::get_id()];
+    if (!shard) {
+        shard = _shards.emplace_back(std::make_unique<Shard>()).get();
+    }
+    threadCache.insert(_serial, shard);
+    return *shard;
+}
+
+static std::string toString(ID id) { return std::to_string(id.raw()); }
+
+std::unique_ptr<Graph> ConcurrentGraphBuilder::build() {
+    std::lock_guard lock(_mutex);
+    auto root = std::make_unique<Graph>(_rootID);
+    // Gather the children of every graph from all shards. Shards are visited
+    // in the order they were created and buckets hold their entries in append
+    // order, so children are ordered by shard serial and then by the serial
+    // of the append within the shard
+    IDMap<Children> children;
+    IDMap<Graph*> graphs;
+    graphs.insert(_rootID, root.get());
+    for (auto& shard: _shards) {
+        for (auto& [parent, bucket]: shard->_buckets) {
+            auto& entry = *children.insert(parent, {}).first;
+            entry.vertices.insert(entry.vertices.end(),
+                                  bucket.vertices.begin(),
+                                  bucket.vertices.end());
+            entry.edges.insert(entry.edges.end(),
+                               bucket.edges.begin(),
+                               bucket.edges.end());
+            for (auto* vertex: bucket.vertices) {
+                auto* graph = vertex->asGraph();
+                if (graph && !graphs.insert(graph->id(), graph).second) {
+                    throw std::runtime_error("Duplicate graph ID " +
+                                             toString(graph->id()));
+                }
+            }
+        }
+    }
+    // Check that all parents exist and all graphs are reachable from the root
+    // before anything is linked, so the builder stays intact on error
+    size_t numVertices = 0;
+    for (auto& shard: _shards) {
+        for (auto& [parent, bucket]: shard->_buckets) {
+            if (!graphs.find(parent)) {
+                throw std::runtime_error("Parent graph " + toString(parent) +
+                                         " does not exist");
+            }
+            numVertices += bucket.vertices.size();
+        }
+    }
+    std::vector<Graph*> order = { root.get() };
+    for (size_t i = 0; i < order.size(); ++i) {
+        auto* entry = children.find(order[i]->id());
+        if (!entry) {
+            continue;
+        }
+        for (auto* vertex: entry->vertices) {
+            if (auto* graph = vertex->asGraph()) {
+                order.push_back(graph);
+            }
+        }
+    }
+    if (order.size() != graphs.size()) {
+        throw std::runtime_error("Graphs are not reachable from the root");
+    }
+    // Link the graphs top down, so every vertex is indexed by the root
+    // directly
+    root->_index = std::make_unique<VertexIndex>();
+    root->_index->reserve(numVertices);
+    for (auto* graph: order) {
+        auto* entry = children.find(graph->id());
+        if (!entry) {
+            continue;
+        }
+        graph->_vertices.reserve(entry->vertices.size());
+        for (auto* vertex: entry->vertices) {
+            graph->add(vertex);
+        }
+        graph->addEdges(entry->edges);
+    }
+    Arena& arena = root->arena();
+    for (auto& shard: _shards) {
+        arena.absorb(shard->_arena);
+        shard->_buckets.clear();
+        shard->_last = nullptr;
+    }
+    return root;
+}
@@ -0,0 +1,330 @@
+#include "dotwriter.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+
+#include "escape.h"
+#include "graphgen/common.h"
+#include "graphgen/config.h"
+
+using namespace graphgen;
+
+Sink& graphgen::operator<<(Sink& str, Quoted quoted) {
+    str.put('"');
+    writeEscaped(str, quoted.text);
+    str.put('"');
+    return str;
+}
+
+Sink& graphgen::operator<<(Sink& str, ID id) {
+    return str << "vertex_" << id.raw();
+}
+
+Sink& graphgen::operator<<(Sink& str, VertexName name) {
+    if (name.names) {
+        if (auto* number = name.names->find(name.id)) {
+            return str << 'v' << *number;
+        }
+    }
+    return str << name.id;
+}
+
+Sink& graphgen::operator<<(Sink& str, GraphKind kind) {
+    using enum GraphKind;
+    switch (kind) {
+    case Directed:
+        return str << "digraph";
+    case Undirected:
+        return str << "graph";
+    case Tree:
+        unreachable();
+    }
+    unreachable();
+}
+
+Sink& graphgen::operator<<(Sink& str, RankDir dir) {
+    return str << toString(dir);
+}
+
+Sink& graphgen::operator<<(Sink& str, VertexShape shape) {
+    return str << '"' << toString(shape) << '"';
+}
+
+std::string_view graphgen::toString(RankDir dir) {
+    using enum RankDir;
+    switch (dir) {
+    case TopBottom:
+        return "TB";
+    case LeftRight:
+        return "LR";
+    case BottomTop:
+        return "BT";
+    case RightLeft:
+        return "RL";
+    }
+    unreachable();
+}
+
+std::string_view graphgen::labelText(Label const& label,
+                                    BufferSink& buffer,
+                                    std::chrono::nanoseconds* generatorTime) {
+    if (!label.isGenerated()) {
+        return label.text();
+    }
+    buffer.clear();
+    auto start = std::chrono::steady_clock::now();
+    label.writeText(buffer);
+    if (generatorTime) {
+        *generatorTime += std::chrono::steady_clock::now() - start;
+    }
+    return buffer.view();
+}
+
+std::string_view graphgen::toString(VertexShape shape) {
+    using enum VertexShape;
+    switch (shape) {
+    case Box:
+        return "box";
+    case Ellipse:
+        return "ellipse";
+    case Oval:
+        return "oval";
+    case Circle:
+        return "circle";
+    case Point:
+        return "point";
+    }
+    unreachable();
+}
+
+std::string_view graphgen::toString(Color color) {
+    using enum Color;
+    switch (color) {
+    case Black:
+        return "black";
+    case White:
+        return "white";
+    case Red:
+        return "red";
+    case Green:
+        return "green";
+    case Yellow:
+        return "yellow";
+    case Blue:
+        return "blue";
+    case Magenta:
+        return "magenta";
+    case Purple:
+        return "purple";
+    }
+    unreachable();
+}
+
+std::string_view graphgen::toString(Style style) {
+    using enum Style;
+    switch (style) {
+    case Dashed:
+        return "dashed";
+    case Dotted:
+        return "dotted";
+    case Solid:
+        return "solid";
+    case Invisible:
+        return "invis";
+    case Bold:
+        return "bold";
+    }
+    unreachable();
+}
+
+static char const* open(ScopeKind kind) {
+    return std::array{ "{", "[" }[static_cast<size_t>(kind)];
+}
+
+static char const* close(ScopeKind kind) {
+    return std::array{ "}", "]" }[static_cast<size_t>(kind)];
+}
+
+/// Graphs are named by their declaration, vertices by their ID
+static StreamManip scopeName = [](Sink& str,
+                                  DotWriter::Scope scope,
+                                  GraphKind graphKind,
+                                  IDMap<size_t> const* names) {
+    switch (scope.kind) {
+    case ScopeKind::Brace:
+        if (scope.isRoot) {
+            str << graphKind;
+        }
+        else {
+            str << "subgraph cluster_" << VertexName{ scope.id, names };
+        }
+        break;
+    case ScopeKind::Bracket:
+        str << VertexName{ scope.id, names };
+        break;
+    }
+};
+
+/// Spaces for one or more levels of indentation
+static constexpr std::string_view Spaces =
+    "                                                                ";
+
+/// \Returns a handle to the current default font. Fonts inherited by child
+/// contexts may outlive the writer that looked them up, so default fonts are
+/// kept for the lifetime of the process. There are only a few of them
+static InternedString internDefaultFont() {
+    static StringPool pool;
+    return pool.intern(defaultFont());
+}
+
+DotWriter::DotWriter(Sink& str, GraphKind graphKind, int indent):
+    str(str),
+    graphKind(graphKind),
+    currentIndent(indent),
+    defaultFontName(internDefaultFont()) {}
+
+void DotWriter::beginScope(ScopeKind kind,
+                           ID id,
+                           bool isRoot,
+                           std::optional<std::string_view> font) {
+    openScopes.push({ kind, id, isRoot, font.has_value() });
+    line(scopeName(openScopes.top(), graphKind, names), " ", open(kind));
+    ++currentIndent;
+    if (font) {
+        fontStack.push(*font);
+    }
+    if (kind == ScopeKind::Brace) {
+        nodeDefaultStack.push_back(nodeDefaults());
+    }
+}
+
+void DotWriter::endScope() {
+    assert(!openScopes.empty() && "No open scope");
+    --currentIndent;
+    Scope scope = openScopes.top();
+    openScopes.pop();
+    line(close(scope.kind), " // ", scopeName(scope, graphKind, names));
+    if (scope.hasFont) {
+        fontStack.pop();
+    }
+    if (scope.kind == ScopeKind::Brace) {
+        nodeDefaultStack.pop_back();
+    }
+}
+
+void DotWriter::declareNodeDefaults(NodeDefaults const& defaults) {
+    assert(!nodeDefaultStack.empty() && "Must be called in a graph scope");
+    auto& current = nodeDefaultStack.back();
+    char const* separator = "";
+    indent();
+    str << "node [";
+    if (defaults.label) {
+        str << separator << "label = " << *defaults.label;
+        separator = ", ";
+        current.label = defaults.label;
+    }
+    if (defaults.font) {
+        str << separator << "fontname = " << Quoted{ *defaults.font };
+        separator = ", ";
+        current.font = defaults.font;
+    }
+    if (defaults.shape) {
+        str << separator << "shape = " << *defaults.shape;
+        current.shape = defaults.shape;
+    }
+    str << "]\n";
+}
+
+void DotWriter::declareEdgeDefaults(EdgeDefaults const& defaults) {
+    assert(!openScopes.empty() && "Must be called in a graph scope");
+    auto& current = openScopes.top().edgeDefaults;
+    char const* separator = "";
+    indent();
+    str << "edge [";
+    if (defaults.color) {
+        str << separator << "color = \"" << toString(*defaults.color) << "\"";
+        separator = ", ";
+        current.color = defaults.color;
+    }
+    if (defaults.style) {
+        str << separator << "style = \"" << toString(*defaults.style) << "\"";
+        current.style = defaults.style;
+    }
+    str << "]\n";
+}
+
+static StreamManip makeEdge = [](Sink& str,
+                                 Edge edge,
+                                 GraphKind kind,
+                                 DotWriter::EdgeDefaults defaults,
+                                 IDMap<size_t> const* names,
+                                 size_t count,
+                                 EdgeCoalescing mode) {
+    str << VertexName{ edge.from, names };
+    switch (kind) {
+    case GraphKind::Directed:
+        str << " -> ";
+        break;
+    case GraphKind::Undirected:
+        str << " -- ";
+        break;
+    case GraphKind::Tree:
+        assert(false);
+        break;
+    }
+    str << VertexName{ edge.to, names };
+    if (edge.color && edge.color != defaults.color) {
+        str << " [color=\"" << toString(*edge.color) << "\"]";
+    }
+    if (edge.style && edge.style != defaults.style) {
+        str << " [style=\"" << toString(*edge.style) << "\"]";
+    }
+    if (count < 2) {
+        return;
+    }
+    switch (mode) {
+    case EdgeCoalescing::PenWidth:
+        str << " [penwidth=" << std::bit_width(count) << "]";
+        break;
+    case EdgeCoalescing::Label:
+        str << " [label=\"" << count << "\"]";
+        break;
+    default:
+        break;
+    }
+};
+
+void DotWriter::edge(Edge const& edge) {
+    this->edge(edge, 1, EdgeCoalescing::None);
+}
+
+void DotWriter::edge(Edge const& edge, size_t count, EdgeCoalescing mode) {
+    auto defaults = openScopes.empty() ? EdgeDefaults{} :
+                                         openScopes.top().edgeDefaults;
+    line(makeEdge(edge, graphKind, defaults, names, count, mode));
+}
+
+std::string_view DotWriter::getFont(
+    std::optional<std::string_view> font) const {
+    if (font) {
+        return *font;
+    }
+    if (!fontStack.empty()) {
+        return fontStack.top();
+    }
+    return defaultFontName;
+}
+
+void graphgen::writeSpaces(Sink& str, size_t count) {
+    while (count > 0) {
+        size_t n = std::min(count, Spaces.size());
+        str.write(Spaces.substr(0, n));
+        count -= n;
+    }
+}
+
+void DotWriter::indent() {
+    writeSpaces(str, static_cast<size_t>(currentIndent) * 4);
+}
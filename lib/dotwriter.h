@@ -0,0 +1,228 @@
+#ifndef GRAPHGEN_DOTWRITER_H_
+#define GRAPHGEN_DOTWRITER_H_
+
+#include <chrono>
+#include <optional>
+#include <stack>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "graphgen/generate.h"
+#include "graphgen/graph.h"
+#include "graphgen/intern.h"
+#include "graphgen/sink.h"
+#include "idmap.h"
+#include "util.h"
+
+namespace graphgen {
+
+/// Writes \p text in double quotes, escaping `"`, `\` and newlines
+struct Quoted {
+    std::string_view text;
+};
+
+Sink& operator<<(Sink& str, Quoted quoted);
+
+Sink& operator<<(Sink& str, ID id);
+
+/// Writes the name of the vertex \p id. If \p names is not null, the vertex
+/// is named `v<n>` where `n` is the number assigned to \p id in \p names
+struct VertexName {
+    ID id;
+    IDMap<size_t> const* names;
+};
+
+Sink& operator<<(Sink& str, VertexName name);
+
+Sink& operator<<(Sink& str, GraphKind kind);
+
+Sink& operator<<(Sink& str, RankDir dir);
+
+Sink& operator<<(Sink& str, VertexShape shape);
+
+std::string_view toString(RankDir dir);
+
+std::string_view toString(VertexShape shape);
+
+std::string_view toString(Color color);
+
+std::string_view toString(Style style);
+
+/// \Returns the text of \p label. Generated labels are run into \p buffer and
+/// the time spent is added to \p generatorTime if it is not null
+std::string_view labelText(Label const& label,
+                           BufferSink& buffer,
+                           std::chrono::nanoseconds* generatorTime);
+
+/// Writes \p count spaces to \p str
+void writeSpaces(Sink& str, size_t count);
+
+enum class ScopeKind { Brace, Bracket };
+
+/// \Returns `true` if \p a and \p b are text labels of the same kind and with
+/// the same text. Generated labels never compare equal
+inline bool equalText(Label const& a, Label const& b) {
+    return !a.isGenerated() && !b.isGenerated() && a.kind() == b.kind() &&
+           a.text() == b.text();
+}
+
+/// Low level writer for graphviz code. This implements indentation, scopes,
+/// font inheritance and the attribute declarations of vertices and edges. It
+/// is shared by the tree generator and the `StreamingGraphWriter`
+class DotWriter {
+public:
+    /// Attribute values that vertices inherit from `node [...]` statements
+    struct NodeDefaults {
+        std::optional<Label> label;
+        std::optional<std::string_view> font;
+        std::optional<VertexShape> shape;
+    };
+
+    /// Attribute values that edges inherit from `edge [...]` statements
+    struct EdgeDefaults {
+        std::optional<Color> color;
+        std::optional<Style> style;
+    };
+
+    /// Scopes are `{ ... }` for graphs and `[ ... ]` for vertices
+    struct Scope {
+        ScopeKind kind;
+        ID id;
+        bool isRoot;
+        bool hasFont;
+        EdgeDefaults edgeDefaults = {};
+    };
+
+    DotWriter(Sink& str, GraphKind graphKind, int indent = 0);
+
+    /// Opens a scope for the vertex \p id. If \p font is set it is inherited
+    /// by all vertices declared in the scope
+    void beginScope(ScopeKind kind,
+                    ID id,
+                    bool isRoot,
+                    std::optional<std::string_view> font);
+
+    /// Closes the innermost scope
+    void endScope();
+
+    /// \Returns the number of open scopes
+    size_t depth() const { return openScopes.size(); }
+
+    /// \Returns the current indentation level
+    int indentation() const { return currentIndent; }
+
+    /// \Returns the font inherited from the enclosing scopes if any
+    std::optional<std::string_view> inheritedFont() const {
+        return fontStack.empty() ? std::nullopt :
+                                   std::optional(fontStack.top());
+    }
+
+    /// Makes \p font the inherited font of all following declarations. This
+    /// is used to continue generation of a subtree in another writer
+    void inheritFont(std::string_view font) { fontStack.push(font); }
+
+    /// \Returns the node defaults in effect in the innermost graph scope
+    NodeDefaults const& nodeDefaults() const {
+        static NodeDefaults const none{};
+        return nodeDefaultStack.empty() ? none : nodeDefaultStack.back();
+    }
+
+    /// Makes \p defaults the node defaults in effect without declaring them.
+    /// This is used to continue generation of a subtree in another writer
+    void inheritNodeDefaults(NodeDefaults defaults) {
+        nodeDefaultStack.push_back(std::move(defaults));
+    }
+
+    /// Declares the set values of \p defaults in a `node [...]` statement.
+    /// Vertices in the current graph scope and nested scopes omit attributes
+    /// that match the defaults
+    void declareNodeDefaults(NodeDefaults const& defaults);
+
+    /// Declares the set values of \p defaults in an `edge [...]` statement.
+    /// Edges declared in the current graph scope afterwards omit attributes
+    /// that match the defaults
+    void declareEdgeDefaults(EdgeDefaults const& defaults);
+
+    /// Declares label, font, shape, color and style of \p vertex. `V` is any
+    /// type that implements the accessors of `VertexMixin`
+    template <typename V>
+    void commonDecls(V const& vertex) {
+        NodeDefaults const* defaults = vertexDefaults();
+        if (!defaults || !defaults->label ||
+            !equalText(*defaults->label, vertex.label()))
+        {
+            if (generatorTime && vertex.label().isGenerated()) {
+                auto start = std::chrono::steady_clock::now();
+                line("label = ", vertex.label());
+                *generatorTime += std::chrono::steady_clock::now() - start;
+            }
+            else {
+                line("label = ", vertex.label());
+            }
+        }
+        std::string_view font = getFont(vertex.font());
+        if (!defaults || defaults->font != font) {
+            line("fontname = ", Quoted{ font });
+        }
+        if (!defaults || defaults->shape != vertex.shape()) {
+            line("shape = ", vertex.shape());
+        }
+        if (vertex.color()) {
+            line("color = ", toString(*vertex.color()));
+        }
+        if (vertex.style()) {
+            line("style = ", toString(*vertex.style()));
+        }
+    }
+
+    /// Declares the edge \p edge
+    void edge(Edge const& edge);
+
+    /// Declares the edge \p edge that stands for \p count equal edges. \p mode
+    /// determines how the count is drawn
+    void edge(Edge const& edge, size_t count, EdgeCoalescing mode);
+
+    /// \Returns \p font if set, otherwise the innermost inherited font or the
+    /// default font. All fonts are interned, so the returned view is valid for
+    /// the lifetime of the program
+    std::string_view getFont(std::optional<std::string_view> font) const;
+
+    void line(auto const&... args) {
+        indent();
+        ((str << args), ...);
+        str.put('\n');
+    }
+
+    void indent();
+
+    Sink& str;
+    GraphKind graphKind;
+
+    /// Compact names of vertices. If null, names are derived from raw IDs
+    IDMap<size_t> const* names = nullptr;
+
+    /// If not null, the time spent emitting generated labels is added here
+    std::chrono::nanoseconds* generatorTime = nullptr;
+
+private:
+    /// \Returns the node defaults if the innermost scope is a vertex
+    NodeDefaults const* vertexDefaults() const {
+        if (openScopes.empty() || openScopes.top().kind != ScopeKind::Bracket ||
+            nodeDefaultStack.empty())
+        {
+            return nullptr;
+        }
+        return &nodeDefaultStack.back();
+    }
+
+    int currentIndent = 0;
+    std::stack<Scope> openScopes;
+    std::stack<std::string_view> fontStack;
+    InternedString defaultFontName;
+    std::vector<NodeDefaults> nodeDefaultStack;
+};
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_DOTWRITER_H_
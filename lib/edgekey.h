@@ -0,0 +1,82 @@
+#ifndef GRAPHGEN_EDGEKEY_H_
+#define GRAPHGEN_EDGEKEY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "graphgen/graph.h"
+
+namespace graphgen {
+
+/// Endpoints and attributes of an edge packed for hashing. Edges with equal
+/// keys are drawn identically
+struct EdgeKey {
+    uintptr_t from;
+    uintptr_t to;
+    unsigned attributes;
+
+    /// \Returns the key of \p edge. If \p undirected is set the endpoints are
+    /// ordered, so both directions of an edge have the same key
+    static EdgeKey of(Edge const& edge, bool undirected = false) {
+        EdgeKey key{ edge.from.raw(), edge.to.raw(), 0 };
+        if (undirected && key.to < key.from) {
+            std::swap(key.from, key.to);
+        }
+        unsigned color = edge.color ? unsigned(*edge.color) + 1 : 0;
+        unsigned style = edge.style ? unsigned(*edge.style) + 1 : 0;
+        key.attributes = color << 8 | style;
+        return key;
+    }
+
+    bool operator==(EdgeKey const&) const = default;
+};
+
+} // namespace graphgen
+
+template <>
+struct std::hash<graphgen::EdgeKey> {
+    std::size_t operator()(graphgen::EdgeKey const& key) const {
+        std::size_t hash = std::hash<uintptr_t>{}(key.from);
+        hash ^= std::hash<uintptr_t>{}(key.to) + 0x9e3779b97f4a7c15 +
+                (hash << 6) + (hash >> 2);
+        return hash ^ key.attributes;
+    }
+};
+
+namespace graphgen {
+
+/// Finds the distinct edges of a graph. The buffers are reused for all graphs
+/// a coalescer is run on
+struct EdgeCoalescer {
+    std::vector<std::pair<Edge, size_t>> edges;
+    std::unordered_map<EdgeKey, size_t> indices;
+
+    /// \Returns the distinct edges in \p range in the order of their first
+    /// occurrence together with their number of occurrences
+    template <typename Range>
+    std::span<std::pair<Edge, size_t> const> run(Range const& range,
+                                                 bool undirected) {
+        edges.clear();
+        indices.clear();
+        for (Edge edge: range) {
+            auto [itr, inserted] = indices.insert(
+                { EdgeKey::of(edge, undirected), edges.size() });
+            if (inserted) {
+                edges.push_back({ edge, 1 });
+            }
+            else {
+                ++edges[itr->second].second;
+            }
+        }
+        return edges;
+    }
+};
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_EDGEKEY_H_
@@ -0,0 +1,253 @@
+#include "escape.h"
+
+#include <array>
+#include <bit>
+#include <ostream>
+
+#include "graphgen/sink.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define GRAPHGEN_SSE2 1
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define GRAPHGEN_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+using namespace graphgen;
+
+static size_t findScalar(char const* data,
+                         size_t size,
+                         size_t pos,
+                         char a,
+                         char b,
+                         char c) {
+    for (; pos < size; ++pos) {
+        char x = data[pos];
+        if (x == a || x == b || x == c) {
+            return pos;
+        }
+    }
+    return size;
+}
+
+#if GRAPHGEN_SSE2
+
+/// SSE2 is part of x86-64, so this needs no runtime check
+static size_t findSSE2(char const* data,
+                       size_t size,
+                       size_t pos,
+                       char a,
+                       char b,
+                       char c) {
+    __m128i va = _mm_set1_epi8(a);
+    __m128i vb = _mm_set1_epi8(b);
+    __m128i vc = _mm_set1_epi8(c);
+    for (; pos + 16 <= size; pos += 16) {
+        __m128i chunk =
+            _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + pos));
+        __m128i match = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb)),
+            _mm_cmpeq_epi8(chunk, vc));
+        if (int mask = _mm_movemask_epi8(match)) {
+            return pos + std::countr_zero(static_cast<unsigned>(mask));
+        }
+    }
+    return findScalar(data, size, pos, a, b, c);
+}
+
+#endif
+
+#if GRAPHGEN_AVX2
+
+__attribute__((target("avx2"))) static size_t findAVX2(char const* data,
+                                                       size_t size,
+                                                       size_t pos,
+                                                       char a,
+                                                       char b,
+                                                       char c) {
+    __m256i va = _mm256_set1_epi8(a);
+    __m256i vb = _mm256_set1_epi8(b);
+    __m256i vc = _mm256_set1_epi8(c);
+    for (; pos + 32 <= size; pos += 32) {
+        __m256i chunk =
+            _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + pos));
+        __m256i match =
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, va),
+                                            _mm256_cmpeq_epi8(chunk, vb)),
+                            _mm256_cmpeq_epi8(chunk, vc));
+        if (int mask = _mm256_movemask_epi8(match)) {
+            return pos + std::countr_zero(static_cast<unsigned>(mask));
+        }
+    }
+    return findSSE2(data, size, pos, a, b, c);
+}
+
+#endif
+
+using FindFunction = size_t (*)(char const*, size_t, size_t, char, char, char);
+
+static FindFunction selectFind() {
+#if GRAPHGEN_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return findAVX2;
+    }
+#endif
+#if GRAPHGEN_SSE2
+    return findSSE2;
+#else
+    return findScalar;
+#endif
+}
+
+size_t graphgen::findFirstOf(std::string_view text,
+                             size_t pos,
+                             char a,
+                             char b,
+                             char c) {
+    // Most labels are short, and the vector loops would only run their
+    // scalar tail for them
+    if (text.size() - pos < 16) {
+        return findScalar(text.data(), text.size(), pos, a, b, c);
+    }
+    static FindFunction const find = selectFind();
+    return find(text.data(), text.size(), pos, a, b, c);
+}
+
+/// Invokes \p write with the runs of \p text between escaped characters and
+/// the escape sequences
+template <typename Write>
+static void forEachEscaped(std::string_view text, Write write) {
+    size_t pos = 0;
+    while (true) {
+        size_t next = findFirstOf(text, pos, '"', '\\', '\n');
+        write(text.substr(pos, next - pos));
+        if (next == text.size()) {
+            return;
+        }
+        switch (text[next]) {
+        case '"':
+            write("\\\"");
+            break;
+        case '\\':
+            write("\\\\");
+            break;
+        default:
+            write("\\n");
+            break;
+        }
+        pos = next + 1;
+    }
+}
+
+void graphgen::writeEscaped(Sink& sink, std::string_view text) {
+    forEachEscaped(text, [&](std::string_view run) { sink.write(run); });
+}
+
+void graphgen::writeEscaped(std::ostream& ostream, std::string_view text) {
+    forEachEscaped(text, [&](std::string_view run) { ostream << run; });
+}
+
+/// Characters that are escaped in JSON strings and in XML
+static constexpr auto jsonSpecial = [] {
+    std::array<bool, 256> table{};
+    for (int c = 0; c < 0x20; ++c) {
+        table[c] = true;
+    }
+    table['"'] = table['\\'] = true;
+    return table;
+}();
+
+static constexpr auto xmlSpecial = [] {
+    std::array<bool, 256> table{};
+    for (int c = 0; c < 0x20; ++c) {
+        table[c] = c != '\t' && c != '\n' && c != '\r';
+    }
+    table['&'] = table['<'] = table['>'] = table['"'] = true;
+    return table;
+}();
+
+/// Writes the runs of \p text between characters marked in \p special to
+/// \p sink and passes the marked characters to \p escape
+template <typename Escape>
+static void escapeWith(Sink& sink,
+                       std::string_view text,
+                       std::array<bool, 256> const& special,
+                       Escape escape) {
+    size_t begin = 0;
+    for (size_t pos = 0; pos < text.size(); ++pos) {
+        auto c = static_cast<unsigned char>(text[pos]);
+        if (special[c]) {
+            sink.write(text.substr(begin, pos - begin));
+            escape(c);
+            begin = pos + 1;
+        }
+    }
+    sink.write(text.substr(begin));
+}
+
+void graphgen::writeJSONEscaped(Sink& sink, std::string_view text) {
+    escapeWith(sink, text, jsonSpecial, [&](unsigned char c) {
+        switch (c) {
+        case '"':
+            sink.write("\\\"");
+            break;
+        case '\\':
+            sink.write("\\\\");
+            break;
+        case '\n':
+            sink.write("\\n");
+            break;
+        case '\t':
+            sink.write("\\t");
+            break;
+        case '\r':
+            sink.write("\\r");
+            break;
+        default: {
+            char const* hex = "0123456789abcdef";
+            char escaped[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15] };
+            sink.write({ escaped, sizeof escaped });
+            break;
+        }
+        }
+    });
+}
+
+void graphgen::writeXMLEscaped(Sink& sink, std::string_view text) {
+    escapeWith(sink, text, xmlSpecial, [&](unsigned char c) {
+        switch (c) {
+        case '&':
+            sink.write("&amp;");
+            break;
+        case '<':
+            sink.write("&lt;");
+            break;
+        case '>':
+            sink.write("&gt;");
+            break;
+        case '"':
+            sink.write("&quot;");
+            break;
+        default:
+            // Other control characters cannot be represented in XML 1.0
+            break;
+        }
+    });
+}
+
+bool graphgen::isBalancedHTML(std::string_view text) {
+    size_t depth = 0;
+    for (size_t pos = findFirstOf(text, 0, '<', '>', '>'); pos < text.size();
+         pos = findFirstOf(text, pos + 1, '<', '>', '>'))
+    {
+        if (text[pos] == '<') {
+            ++depth;
+        }
+        else if (depth-- == 0) {
+            return false;
+        }
+    }
+    return depth == 0;
+}
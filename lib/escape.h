@@ -0,0 +1,44 @@
+#ifndef GRAPHGEN_ESCAPE_H_
+#define GRAPHGEN_ESCAPE_H_
+
+#include <cstddef>
+#include <iosfwd>
+#include <string_view>
+
+namespace graphgen {
+
+class Sink;
+
+/// \Returns the index of the first occurrence of \p a, \p b or \p c in \p text
+/// at or after \p pos or `text.size()` if there is none. This compares 16 or
+/// 32 bytes at a time where SSE2 or AVX2 is available
+std::size_t findFirstOf(std::string_view text,
+                        std::size_t pos,
+                        char a,
+                        char b,
+                        char c);
+
+/// Writes \p text to \p sink as the content of a quoted DOT string, i.e. with
+/// `"` and `\` escaped by a backslash and newlines written as `\n`. Runs of
+/// characters that need no escaping are copied in bulk
+void writeEscaped(Sink& sink, std::string_view text);
+
+/// \overload for `std::ostream`
+void writeEscaped(std::ostream& ostream, std::string_view text);
+
+/// Writes \p text to \p sink as the content of a JSON string, i.e. with `"`,
+/// `\` and control characters escaped
+void writeJSONEscaped(Sink& sink, std::string_view text);
+
+/// Writes \p text to \p sink as XML character data or attribute value, i.e.
+/// with `&`, `<`, `>` and `"` replaced by entities. Control characters other
+/// than tab, newline and carriage return are not allowed in XML and dropped
+void writeXMLEscaped(Sink& sink, std::string_view text);
+
+/// \Returns `true` if every `>` in \p text closes a preceding `<` and every
+/// `<` is closed, i.e. if \p text can be used as an HTML label
+bool isBalancedHTML(std::string_view text);
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_ESCAPE_H_
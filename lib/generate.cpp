@@ -1,266 +1,903 @@
 #include "graphgen/generate.h"
 
-#include <array>
-#include <cassert>
-#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
 #include <iostream>
-#include <sstream>
-#include <stack>
-
-#include "graphgen/common.h"
-#include "graphgen/config.h"
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "dotwriter.h"
+#include "edgekey.h"
 #include "graphgen/graph.h"
+#include "graphgen/sink.h"
+#include "graphgen/validate.h"
+#include "graphmlwriter.h"
+#include "idmap.h"
+#include "jsonwriter.h"
+#include "outputcache.h"
+#include "threadpool.h"
+#include "traversal.h"
 #include "util.h"
-#include "vertexvisitor.h"
 
 using namespace graphgen;
 
-static std::ostream& operator<<(std::ostream& str, ID id) {
-    return str << "vertex_" << id.raw();
-}
-
-static std::ostream& operator<<(std::ostream& str, GraphKind kind) {
-    using enum GraphKind;
-    switch (kind) {
-    case Directed:
-        return str << "digraph";
-    case Undirected:
-        return str << "graph";
-    case Tree:
-        unreachable();
-    }
-    unreachable();
-}
+namespace {
 
-static std::ostream& operator<<(std::ostream& str, RankDir dir) {
-    using enum RankDir;
-    switch (dir) {
-    case TopBottom:
-        return str << "TB";
-    case LeftRight:
-        return str << "LR";
-    case BottomTop:
-        return str << "BT";
-    case RightLeft:
-        return str << "RL";
-    }
-    unreachable();
-}
+using Clock = std::chrono::steady_clock;
 
-static std::ostream& operator<<(std::ostream& str, VertexShape shape) {
-    using enum VertexShape;
-    switch (shape) {
-    case Box:
-        return str << std::quoted("box");
-    case Ellipse:
-        return str << std::quoted("ellipse");
-    case Oval:
-        return str << std::quoted("oval");
-    case Circle:
-        return str << std::quoted("circle");
-    case Point:
-        return str << std::quoted("point");
-    }
-    unreachable();
-}
+/// Statistics gathered by one context
+struct Counters {
+    size_t vertices = 0;
+    size_t edges = 0;
+    size_t subgraphs = 0;
+    size_t maxDepth = 0;
+    std::chrono::nanoseconds generatorTime{};
+};
 
-static StreamManip declare = [](std::ostream& str, Graph const& graph) {
-    if (graph.parent()) {
-        str << "subgraph cluster_" << graph.id();
+/// Merges the counters of all contexts of one generation into
+/// `GenerateStats`
+struct StatsCollector {
+    explicit StatsCollector(GenerateStats& stats): stats(stats) {}
+
+    std::mutex mutex;
+    GenerateStats& stats;
+
+    void merge(Counters const& counters) {
+        std::lock_guard lock(mutex);
+        stats.vertices += counters.vertices;
+        stats.edges += counters.edges;
+        stats.subgraphs += counters.subgraphs;
+        stats.maxDepth = std::max(stats.maxDepth, counters.maxDepth);
+        stats.labelGeneratorTime += counters.generatorTime;
     }
-    else {
-        str << graph.kind();
+
+    void addTime(ptrdiff_t topLevel, Clock::duration time) {
+        std::lock_guard lock(mutex);
+        stats.subgraphTimes[static_cast<size_t>(topLevel)].time += time;
     }
 };
 
-static std::string_view toString(Color color) {
-    using enum Color;
-    switch (color) {
-    case Black:
-        return "black";
-    case White:
-        return "white";
-    case Red:
-        return "red";
-    case Green:
-        return "green";
-    case Yellow:
-        return "yellow";
-    case Blue:
-        return "blue";
-    case Magenta:
-        return "magenta";
-    case Purple:
-        return "purple";
-    }
-    unreachable();
-}
+struct Context: TraversalCallbacks {
+    Graph const& graph;
+    GenerateOptions const& options;
+    DotWriter writer;
+
+    /// Set if statistics are collected. Every context counts locally and
+    /// merges its counters when it is done
+    StatsCollector* stats = nullptr;
+    Counters counters;
+
+    /// Index of the top level subgraph that is being generated in
+    /// `GenerateStats::subgraphTimes` or -1
+    ptrdiff_t topLevel = -1;
+
+    /// Index of the next top level subgraph. Only used by the root context
+    ptrdiff_t nextTopLevel = 0;
+
+    /// Start of the top level subgraph that is being generated in place
+    std::optional<Clock::time_point> topLevelStart;
+
+    /// Set in parallel and in incremental mode. Every subgraph below `graph`
+    /// is then generated into a new fragment, in parallel mode by a separate
+    /// task
+    ThreadPool* pool = nullptr;
+    Fragment* fragment = nullptr;
+
+    /// Tasks of spawned subgraphs if there is no pool. They are run after the
+    /// spawning task, so nested subgraphs do not recurse
+    std::vector<std::function<void()>>* deferred = nullptr;
+
+    Context(Graph const& graph,
+            GenerateOptions const& options,
+            IDMap<size_t> const* names,
+            GraphKind kind,
+            Sink& str,
+            int indent = 0):
+        graph(graph), options(options), writer(str, kind, indent) {
+        writer.names = names;
+    }
 
-static std::string_view toString(Style style) {
-    using enum Style;
-    switch (style) {
-    case Dashed:
-        return "dashed";
-    case Dotted:
-        return "dotted";
-    case Solid:
-        return "solid";
-    case Invisible:
-        return "invis";
-    case Bold:
-        return "bold";
-    }
-    unreachable();
-}
+    void beginScope(Vertex const& vertex, ScopeKind kind) {
+        size_t depth = static_cast<size_t>(writer.indentation());
+        auto* observer = options.observer;
+        if (kind == ScopeKind::Brace) {
+            counters.subgraphs += depth > 0;
+            counters.maxDepth = std::max(counters.maxDepth, depth);
+            if (observer) {
+                observer->beginGraph(static_cast<Graph const&>(vertex), depth);
+            }
+        }
+        else {
+            ++counters.vertices;
+            if (observer) {
+                observer->beginVertex(vertex, depth);
+            }
+        }
+        writer.beginScope(kind, vertex.id(), !vertex.parent(), vertex.font());
+    }
+
+    void endScope(Vertex const& vertex, ScopeKind kind) {
+        writer.endScope();
+        auto* observer = options.observer;
+        if (!observer) {
+            return;
+        }
+        size_t depth = static_cast<size_t>(writer.indentation());
+        if (kind == ScopeKind::Brace) {
+            observer->endGraph(static_cast<Graph const&>(vertex), depth);
+        }
+        else {
+            observer->endVertex(vertex, depth);
+        }
+    }
+
+    void run() { traverse(graph, *this); }
+
+    /// Enables statistics for this context
+    void collect(StatsCollector* collector) {
+        stats = collector;
+        writer.generatorTime = collector ? &counters.generatorTime : nullptr;
+    }
+
+    /// Merges the statistics of this context
+    void finish() {
+        if (stats) {
+            stats->merge(counters);
+        }
+    }
+
+    /// Continues generation of the enclosing scopes of another writer
+    void inherit(std::optional<std::string_view> font,
+                 DotWriter::NodeDefaults defaults) {
+        if (font) {
+            writer.inheritFont(*font);
+        }
+        writer.inheritNodeDefaults(std::move(defaults));
+    }
+
+    /// \Returns `true` if generated code of graphs is cached
+    bool incremental() const { return options.incremental && !writer.names; }
+
+    /// \Returns the key of the code of \p graph in the current scope
+    OutputKey outputKey(Graph const& graph) const {
+        return OutputKey(writer.indentation(),
+                         !graph.parent(),
+                         options.hoistDefaults,
+                         options.coalesceEdges,
+                         writer.graphKind,
+                         writer.inheritedFont(),
+                         writer.nodeDefaults());
+    }
+
+    bool enterGraph(Graph const& graph);
+
+    void leaveGraph(Graph const& graph);
+
+    void vertex(Vertex const& vertex);
+
+    /// Opens the scope of \p graph and declares its attributes
+    void openGraph(Graph const& graph);
+
+    /// Generates \p subgraph into a new child fragment or reuses its cached
+    /// fragment. \p topLevel is the index of the containing top level
+    /// subgraph
+    void spawn(Graph const& subgraph, ptrdiff_t topLevel);
+
+    /// \Returns the cached code of the shared graph of \p subgraph for the
+    /// scope of \p child or generates it into \p child on the calling thread
+    /// and caches it in the shared graph
+    Fragment const* sharedOutput(Graph const& subgraph,
+                                 std::unique_ptr<Fragment> child);
+
+    void hoistNodeDefaults(Graph const& graph);
+
+    void hoistEdgeDefaults(Graph const& graph);
+
+    /// Declares each distinct edge of \p graph once
+    void coalesceEdges(Graph const& graph);
+
+    EdgeCoalescer coalescer;
+};
+
+} // namespace
 
 namespace {
 
-enum ScopeKind { Brace, Bracket };
+/// Numbers all IDs in the order in which they first appear in the output
+struct CompactNamer: TraversalCallbacks {
+    IDMap<size_t>& names;
+    std::vector<ID>& order;
 
-static char const* open(ScopeKind kind) {
-    return std::array{ "{", "[" }[static_cast<size_t>(kind)];
-}
+    CompactNamer(IDMap<size_t>& names, std::vector<ID>& order):
+        names(names), order(order) {}
 
-static char const* close(ScopeKind kind) {
-    return std::array{ "}", "]" }[static_cast<size_t>(kind)];
-}
+    void name(ID id) {
+        if (names.insert(id, order.size()).second) {
+            order.push_back(id);
+        }
+    }
+
+    bool enterGraph(Graph const& graph) {
+        if (graph.parent()) {
+            name(graph.id());
+        }
+        return true;
+    }
+
+    void leaveGraph(Graph const& graph) {
+        for (Edge edge: graph.edges()) {
+            name(edge.from);
+            name(edge.to);
+        }
+    }
 
-struct Scope {
-    ScopeKind kind;
-    std::string name;
+    void vertex(Vertex const& vertex) { name(vertex.id()); }
 };
 
-struct Context: VertexVisitor {
+/// Generates code through the writer policy `W` of a format other than DOT.
+/// Calls to the writer are resolved statically, so every format gets its own
+/// traversal with the formatting inlined
+template <typename W>
+struct Emitter: TraversalCallbacks {
     Graph const& graph;
-    std::ostream& str;
-
-    int currentIndent = 0;
-    std::stack<Scope> openScopes;
-    std::stack<std::string> fontStack;
-
-    Context(Graph const& graph, std::ostream& str, int indent = 0):
-        graph(graph), str(str), currentIndent(indent) {}
-
-    [[nodiscard]] auto beginScope(Vertex const& vertex,
-                                  ScopeKind kind,
-                                  auto const&... args) {
-        beginScopeImpl(kind, args...);
-        if (vertex.font()) {
-            fontStack.push(*vertex.font());
-        }
-        return ScopeGuard([this, &vertex] {
-            endScopeImpl();
-            if (vertex.font()) {
-                fontStack.pop();
-            }
-        });
+    GenerateOptions const& options;
+    W writer;
+    StatsCollector* stats;
+    Counters counters;
+    EdgeCoalescer coalescer;
+
+    /// Number of open graphs
+    size_t depth = 0;
+
+    /// Index and start of the top level subgraph that is being generated
+    ptrdiff_t topLevel = 0;
+    Clock::time_point topLevelStart;
+
+    Emitter(Graph const& graph,
+            GenerateOptions const& options,
+            IDMap<size_t> const* names,
+            Sink& str,
+            StatsCollector* stats):
+        graph(graph),
+        options(options),
+        writer(str, graph, names),
+        stats(stats) {
+        writer.generatorTime = stats ? &counters.generatorTime : nullptr;
     }
 
-    void beginScopeImpl(ScopeKind kind, auto const&... args) {
-        std::stringstream sstr;
-        ((sstr << args), ...);
-        openScopes.push({ kind, std::move(sstr).str() });
-        line(openScopes.top().name, " ", open(kind));
-        ++currentIndent;
+    bool enterGraph(Graph const& graph) {
+        size_t graphDepth = depth++;
+        counters.subgraphs += graphDepth > 0;
+        counters.maxDepth = std::max(counters.maxDepth, graphDepth);
+        if (options.observer) {
+            options.observer->beginGraph(graph, graphDepth);
+        }
+        if (graphDepth == 0) {
+            writer.beginDocument();
+            return true;
+        }
+        if (stats && graphDepth == 1) {
+            topLevelStart = Clock::now();
+        }
+        writer.beginGraph(graph);
+        return true;
     }
 
-    void endScopeImpl() {
-        --currentIndent;
-        Scope scope = openScopes.top();
-        openScopes.pop();
-        line(close(scope.kind), " // ", scope.name);
+    void leaveGraph(Graph const& graph) {
+        if (options.coalesceEdges == EdgeCoalescing::None) {
+            counters.edges += graph.edges().size();
+            for (Edge edge: graph.edges()) {
+                writer.edge(edge, 1);
+            }
+        }
+        else {
+            bool undirected = this->graph.kind() == GraphKind::Undirected;
+            bool drop = options.coalesceEdges == EdgeCoalescing::Drop;
+            auto coalesced = coalescer.run(graph.edges(), undirected);
+            counters.edges += coalesced.size();
+            for (auto& [edge, count]: coalesced) {
+                writer.edge(edge, drop ? 1 : count);
+            }
+        }
+        size_t graphDepth = --depth;
+        if (graphDepth == 0) {
+            writer.endDocument();
+        }
+        else {
+            writer.endGraph(graph);
+        }
+        if (options.observer) {
+            options.observer->endGraph(graph, graphDepth);
+        }
+        if (stats && graphDepth == 1) {
+            stats->addTime(topLevel++, Clock::now() - topLevelStart);
+        }
     }
 
-    void line(auto const&... args) {
-        indent();
-        ((str << args), ...);
-        str << "\n";
+    void vertex(Vertex const& vertex) {
+        ++counters.vertices;
+        if (options.observer) {
+            options.observer->beginVertex(vertex, depth);
+        }
+        writer.vertex(vertex);
+        if (options.observer) {
+            options.observer->endVertex(vertex, depth);
+        }
     }
+};
 
-    void indent() {
-        for (int i = 0; i < currentIndent; ++i) {
-            str << "    ";
+} // namespace
+
+/// Moves \p root and all fragments generated below it into the output caches
+/// of their graphs. Children are stored before their parents
+static void cache(std::unique_ptr<Fragment> root) {
+    std::vector<std::unique_ptr<Fragment>> fragments;
+    fragments.push_back(std::move(root));
+    for (size_t i = 0; i < fragments.size(); ++i) {
+        for (auto& child: fragments[i]->children) {
+            if (child.owned) {
+                fragments.push_back(std::move(child.owned));
+            }
         }
     }
+    for (auto itr = fragments.rbegin(); itr != fragments.rend(); ++itr) {
+        OutputCache::store(std::move(*itr));
+    }
+}
+
+/// Writes \p root with the text of its children spliced in
+static void write(Fragment const& root, Sink& sink) {
+    struct Frame {
+        Fragment const* fragment;
+        size_t child;
+        size_t pos;
+    };
+    std::vector<Frame> stack = { { &root, 0, 0 } };
+    while (!stack.empty()) {
+        auto& frame = stack.back();
+        std::string_view text = frame.fragment->text.view();
+        if (frame.child == frame.fragment->children.size()) {
+            sink.write(text.substr(frame.pos));
+            stack.pop_back();
+            continue;
+        }
+        auto& child = frame.fragment->children[frame.child++];
+        sink.write(text.substr(frame.pos, child.offset - frame.pos));
+        frame.pos = child.offset;
+        stack.push_back({ child.fragment, 0, 0 });
+    }
+}
 
-    std::string getFont(Vertex const& vertex) const {
-        if (vertex.font()) {
-            return *vertex.font();
+/// Validates \p graph if requested and assigns compact names to its vertices
+static std::optional<IDMap<size_t>> prepare(Graph const& graph,
+                                            GenerateOptions const& options) {
+    if (options.validate) {
+        auto result = validate(graph);
+        if (!result.ok()) {
+            throw InvalidGraphError(std::move(result));
         }
-        if (!fontStack.empty()) {
-            return fontStack.top();
+    }
+    std::optional<IDMap<size_t>> names;
+    if (options.compactIDs) {
+        // Names are assigned up front so they don't depend on the order in
+        // which parallel tasks run
+        std::vector<ID> order;
+        CompactNamer namer(names.emplace(), order);
+        traverse(graph, namer);
+        if (options.idMapping) {
+            for (size_t i = 0; i < order.size(); ++i) {
+                *options.idMapping << 'v' << i << ' ' << order[i].raw() << '\n';
+            }
+            options.idMapping->flush();
+        }
+    }
+    return names;
+}
+
+static void generateDot(Graph const& graph,
+                        Sink& sink,
+                        GenerateOptions const& options,
+                        IDMap<size_t> const* namesPtr,
+                        StatsCollector* stats) {
+    // Spilled subgraphs are only in memory while they are traversed, so they
+    // can be neither cached nor handed to other threads
+    bool budgeted = graph.hasMemoryBudgetInTree();
+    bool incremental = options.incremental && !namesPtr && !budgeted;
+    if ((options.threads <= 1 || budgeted) && !incremental) {
+        Context ctx(graph, options, namesPtr, graph.kind(), sink);
+        ctx.collect(stats);
+        ctx.run();
+        ctx.finish();
+        sink.flush();
+        return;
+    }
+    std::optional<ThreadPool> pool;
+    if (options.threads > 1) {
+        pool.emplace(options.threads);
+    }
+    auto root = std::make_unique<Fragment>();
+    Context ctx(graph, options, namesPtr, graph.kind(), root->text);
+    if (incremental) {
+        root->key = ctx.outputKey(graph);
+        if (auto* cached = OutputCache::find(graph, root->key)) {
+            write(*cached, sink);
+            sink.flush();
+            return;
         }
-        return defaultFont();
+        root->graph = &graph;
+    }
+    std::vector<std::function<void()>> deferred;
+    ctx.pool = pool ? &*pool : nullptr;
+    ctx.deferred = &deferred;
+    ctx.fragment = root.get();
+    ctx.collect(stats);
+    ctx.run();
+    ctx.finish();
+    if (pool) {
+        pool->wait();
+    }
+    while (!deferred.empty()) {
+        auto task = std::move(deferred.back());
+        deferred.pop_back();
+        task();
     }
+    write(*root, sink);
+    if (incremental) {
+        cache(std::move(root));
+    }
+    sink.flush();
+}
 
-    void run() { graph.visit(*this); }
+template <typename W>
+static void emit(Graph const& graph,
+                 Sink& sink,
+                 GenerateOptions const& options,
+                 IDMap<size_t> const* names,
+                 StatsCollector* stats) {
+    Emitter<W> emitter(graph, options, names, sink, stats);
+    traverse(graph, emitter);
+    if (stats) {
+        stats->merge(emitter.counters);
+    }
+    sink.flush();
+}
 
-    void visit(Graph const& graph) override;
+template <Format F>
+static void generateImpl(Graph const& graph,
+                         Sink& sink,
+                         GenerateOptions const& options,
+                         StatsCollector* stats) {
+    auto names = prepare(graph, options);
+    IDMap<size_t> const* namesPtr = names ? &*names : nullptr;
+    if constexpr (F == Format::Dot) {
+        // Graphviz creates vertices for dangling edge endpoints, and hoisted
+        // node defaults would apply to them. Graphs that passed validation in
+        // prepare() have no dangling edges
+        if (options.hoistDefaults && !options.validate &&
+            !validate(graph).danglingEdges.empty())
+        {
+            GenerateOptions rest = options;
+            rest.hoistDefaults = false;
+            generateDot(graph, sink, rest, namesPtr, stats);
+        }
+        else {
+            generateDot(graph, sink, options, namesPtr, stats);
+        }
+    }
+    else if constexpr (F == Format::Json) {
+        emit<JsonWriter>(graph, sink, options, namesPtr, stats);
+    }
+    else {
+        emit<GraphMLWriter>(graph, sink, options, namesPtr, stats);
+    }
+}
 
-    void visit(Vertex const& vertex) override;
+template <Format F>
+void graphgen::generate(Graph const& graph,
+                        Sink& sink,
+                        GenerateOptions const& options) {
+    if (options.reduce) {
+        auto reduced = reduce(graph, *options.reduce);
+        GenerateOptions rest = options;
+        rest.reduce = nullptr;
+        rest.incremental = false;
+        generate<F>(*reduced, sink, rest);
+        return;
+    }
+    if (!options.stats) {
+        generateImpl<F>(graph, sink, options, nullptr);
+        return;
+    }
+    auto start = Clock::now();
+    size_t startBytes = sink.bytesWritten();
+    auto& stats = *options.stats;
+    stats = {};
+    // Slots are created up front so tasks can add to them concurrently
+    for (auto* vertex: graph.vertices()) {
+        if (auto* subgraph = vertex->asGraph()) {
+            stats.subgraphTimes.push_back({ subgraph->id(), {} });
+        }
+    }
+    StatsCollector collector(stats);
+    generateImpl<F>(graph, sink, options, &collector);
+    stats.bytesWritten = sink.bytesWritten() - startBytes;
+    stats.totalTime = Clock::now() - start;
+}
 
-    void commonDecls(Vertex const& vertex);
+template <Format F>
+void graphgen::generate(Graph const& graph,
+                        std::ostream& ostream,
+                        GenerateOptions const& options) {
+    OStreamSink sink(ostream);
+    generate<F>(graph, sink, options);
+}
 
-    void generate(Edge edge);
-};
+template <Format F>
+std::vector<BatchResult> graphgen::generateBatch(
+    std::span<Graph const* const> graphs,
+    std::function<std::filesystem::path(Graph const&, size_t)> const& pathFn,
+    GenerateOptions const& options,
+    size_t maxOpenFiles) {
+    std::vector<BatchResult> results(graphs.size());
+    GenerateOptions local = options;
+    local.threads = 1;
+    local.stats = nullptr;
+    local.observer = nullptr;
+    local.idMapping = nullptr;
+    ReduceOptions reduce;
+    if (options.reduce) {
+        reduce = *options.reduce;
+        reduce.stats = nullptr;
+        local.reduce = &reduce;
+    }
+    // Graphs are handed out one at a time, so threads that get small graphs
+    // take more of them
+    std::atomic<size_t> next = 0;
+    auto work = [&] {
+        // Each thread reuses one sink and its buffer for all of its files
+        std::optional<FileSink> sink;
+        while (true) {
+            size_t index = next.fetch_add(1, std::memory_order_relaxed);
+            if (index >= graphs.size()) {
+                return;
+            }
+            auto& result = results[index];
+            try {
+                result.path = pathFn(*graphs[index], index);
+                if (sink) {
+                    sink->open(result.path);
+                }
+                else {
+                    sink.emplace(result.path);
+                }
+                generate<F>(*graphs[index], *sink, local);
+            }
+            catch (...) {
+                result.error = std::current_exception();
+                // Data of the failed graph must not end up in the next file
+                sink.reset();
+            }
+        }
+    };
+    size_t numThreads = std::min({ std::max<size_t>(options.threads, 1),
+                                   std::max<size_t>(maxOpenFiles, 1),
+                                   graphs.size() });
+    if (numThreads <= 1) {
+        work();
+        return results;
+    }
+    ThreadPool pool(numThreads);
+    for (size_t i = 0; i < numThreads; ++i) {
+        pool.submit(work);
+    }
+    pool.wait();
+    return results;
+}
 
-} // namespace
+#define GRAPHGEN_INSTANTIATE_FORMAT(F)                                         \
+    template GRAPHGEN_API void graphgen::generate<F>(Graph const&,             \
+                                                     Sink&,                    \
+                                                     GenerateOptions const&);  \
+    template GRAPHGEN_API void graphgen::generate<F>(Graph const&,             \
+                                                     std::ostream&,            \
+                                                     GenerateOptions const&);  \
+    template GRAPHGEN_API std::vector<BatchResult>                             \
+    graphgen::generateBatch<F>(                                                \
+        std::span<Graph const* const>,                                         \
+        std::function<std::filesystem::path(Graph const&, size_t)> const&,     \
+        GenerateOptions const&,                                                \
+        size_t);
+
+GRAPHGEN_INSTANTIATE_FORMAT(Format::Dot)
+GRAPHGEN_INSTANTIATE_FORMAT(Format::Json)
+GRAPHGEN_INSTANTIATE_FORMAT(Format::GraphML)
+
+#undef GRAPHGEN_INSTANTIATE_FORMAT
+
+void graphgen::generate(Graph const& graph,
+                        Sink& sink,
+                        GenerateOptions const& options) {
+    generate<Format::Dot>(graph, sink, options);
+}
 
-void graphgen::generate(Graph const& graph, std::ostream& ostream) {
-    Context(graph, ostream).run();
+void graphgen::generate(Graph const& graph,
+                        std::ostream& ostream,
+                        GenerateOptions const& options) {
+    generate<Format::Dot>(graph, ostream, options);
 }
 
 void graphgen::generate(Graph const& graph) { generate(graph, std::cout); }
 
-void Context::visit(Graph const& graph) {
-    auto scope = beginScope(graph, Brace, declare(graph));
-    commonDecls(graph);
-    line("rankdir = ", graph.rankdir());
-    for (auto* vertex: graph.vertices()) {
-        vertex->visit(*this);
+/// Runs generation into an `AsyncFileSink` created from \p destination on a
+/// new thread
+static std::future<void> launchAsync(Graph const& graph,
+                                     auto destination,
+                                     GenerateOptions const& options,
+                                     size_t memoryBudget) {
+    size_t numBlocks = AsyncFileSink::DefaultNumBlocks;
+    size_t blockSize = memoryBudget / numBlocks;
+    return std::async(std::launch::async,
+                      [&graph, destination = std::move(destination), options,
+                       blockSize, numBlocks] {
+        AsyncFileSink sink(destination, blockSize, numBlocks);
+        generate(graph, sink, options);
+    });
+}
+
+std::future<void> graphgen::generateAsync(Graph const& graph,
+                                          std::filesystem::path path,
+                                          GenerateOptions const& options,
+                                          size_t memoryBudget) {
+    return launchAsync(graph, std::move(path), options, memoryBudget);
+}
+
+std::future<void> graphgen::generateAsync(Graph const& graph,
+                                          int fd,
+                                          GenerateOptions const& options,
+                                          size_t memoryBudget) {
+    return launchAsync(graph, fd, options, memoryBudget);
+}
+
+bool Context::enterGraph(Graph const& graph) {
+    if (&graph == &this->graph) {
+        openGraph(graph);
+        return true;
+    }
+    if (stats && writer.indentation() == 1) {
+        topLevel = nextTopLevel++;
+        // Spawned tasks measure themselves
+        if (!fragment) {
+            topLevelStart = Clock::now();
+        }
+    }
+    if (fragment) {
+        spawn(graph, topLevel);
+        return false;
+    }
+    openGraph(graph);
+    return true;
+}
+
+void Context::openGraph(Graph const& graph) {
+    beginScope(graph, ScopeKind::Brace);
+    writer.commonDecls(graph);
+    writer.line("rankdir = ", graph.rankdir());
+    if (options.hoistDefaults) {
+        hoistNodeDefaults(graph);
+    }
+}
+
+void Context::leaveGraph(Graph const& graph) {
+    if (options.hoistDefaults) {
+        hoistEdgeDefaults(graph);
+    }
+    if (options.coalesceEdges == EdgeCoalescing::None) {
+        counters.edges += graph.edges().size();
+        for (Edge edge: graph.edges()) {
+            writer.edge(edge);
+        }
+    }
+    else {
+        coalesceEdges(graph);
     }
-    for (auto& edge: graph.edges()) {
-        generate(edge);
+    endScope(graph, ScopeKind::Brace);
+    if (topLevelStart && writer.indentation() == 1) {
+        stats->addTime(topLevel, Clock::now() - *topLevelStart);
+        topLevelStart.reset();
     }
 }
 
-void Context::visit(Vertex const& vertex) {
-    auto scope = beginScope(vertex, Bracket, vertex.id());
-    commonDecls(vertex);
+void Context::vertex(Vertex const& vertex) {
+    beginScope(vertex, ScopeKind::Bracket);
+    writer.commonDecls(vertex);
+    endScope(vertex, ScopeKind::Bracket);
 }
 
-void Context::commonDecls(Vertex const& vertex) {
-    line("label = ", vertex.label());
-    line("fontname = ", std::quoted(getFont(vertex)));
-    line("shape = ", vertex.shape());
-    if (vertex.color()) {
-        line("color = ", toString(*vertex.color()));
+void Context::spawn(Graph const& subgraph, ptrdiff_t topLevel) {
+    size_t offset = fragment->text.size();
+    auto child = std::make_unique<Fragment>();
+    if (incremental()) {
+        child->key = outputKey(subgraph);
+        if (subgraph.sharedGraph()) {
+            auto* shared = sharedOutput(subgraph, std::move(child));
+            fragment->children.push_back({ offset, nullptr, shared });
+            return;
+        }
+        if (auto* cached = OutputCache::find(subgraph, child->key)) {
+            fragment->children.push_back({ offset, nullptr, cached });
+            return;
+        }
+        child->graph = &subgraph;
     }
-    if (vertex.style()) {
-        line("style = ", toString(*vertex.style()));
+    auto* childPtr = child.get();
+    fragment->children.push_back({ offset, std::move(child), childPtr });
+    auto task = [pool = pool,
+                 deferred = deferred,
+                 options = &options,
+                 fragment = childPtr,
+                 subgraph = &subgraph,
+                 names = writer.names,
+                 kind = writer.graphKind,
+                 indent = writer.indentation(),
+                 font = writer.inheritedFont(),
+                 defaults = writer.nodeDefaults(),
+                 stats = stats,
+                 topLevel] {
+        auto start = Clock::now();
+        Context ctx(*subgraph, *options, names, kind, fragment->text, indent);
+        ctx.pool = pool;
+        ctx.deferred = deferred;
+        ctx.fragment = fragment;
+        ctx.topLevel = topLevel;
+        ctx.inherit(font, defaults);
+        ctx.collect(stats);
+        ctx.run();
+        ctx.finish();
+        if (stats && topLevel >= 0) {
+            stats->addTime(topLevel, Clock::now() - start);
+        }
+    };
+    if (pool) {
+        pool->submit(std::move(task));
+    }
+    else {
+        deferred->push_back(std::move(task));
     }
 }
 
-static StreamManip makeEdge = [](std::ostream& str, Edge edge, GraphKind kind) {
-    str << edge.from;
-    switch (kind) {
-    case GraphKind::Directed:
-        str << " -> ";
-        break;
-    case GraphKind::Undirected:
-        str << " -- ";
-        break;
-    case GraphKind::Tree:
-        assert(false);
-        break;
-    }
-    str << edge.to;
-    if (edge.color) {
-        str << " [color=\"" << toString(*edge.color) << "\"]";
-    }
-    if (edge.style) {
-        str << " [style=\"" << toString(*edge.style) << "\"]";
+Fragment const* Context::sharedOutput(Graph const& subgraph,
+                                      std::unique_ptr<Fragment> child) {
+    Graph const& shared = *subgraph.sharedGraph();
+    if (auto* cached = OutputCache::findShared(shared, child->key)) {
+        return cached;
+    }
+    Context ctx(subgraph,
+                options,
+                writer.names,
+                writer.graphKind,
+                child->text,
+                writer.indentation());
+    ctx.inherit(writer.inheritedFont(), writer.nodeDefaults());
+    ctx.collect(stats);
+    ctx.run();
+    ctx.finish();
+    return OutputCache::storeShared(shared, std::move(child));
+}
+
+/// Finds the most frequent value of `proj(x)` over \p range. Occurrences are
+/// counted in a hash map using \p hash and \p eq, ties go to the value that
+/// reaches the highest count first. \Returns the value and the number of its
+/// occurrences, or no value and 0 if \p range is empty
+template <typename Range,
+          typename Proj,
+          typename T = std::decay_t<
+              std::invoke_result_t<Proj&, std::ranges::range_reference_t<Range>>>,
+          typename Hash = std::hash<T>,
+          typename Eq = std::equal_to<>>
+static auto dominant(Range&& range, Proj proj, Hash hash = {}, Eq eq = {}) {
+    std::unordered_map<T, size_t, Hash, Eq> counts(0, hash, eq);
+    std::optional<T> result;
+    size_t count = 0;
+    for (auto&& elem: range) {
+        T value = std::invoke(proj, elem);
+        size_t n = ++counts[value];
+        if (n > count) {
+            result = std::move(value);
+            count = n;
+        }
+    }
+    return std::pair{ std::move(result), count };
+}
+
+/// Hashes and compares labels by kind and text. Generated labels are only
+/// equal to themselves
+struct LabelTextHash {
+    size_t operator()(Label const* label) const {
+        if (label->isGenerated()) {
+            return std::hash<Label const*>{}(label);
+        }
+        return std::hash<std::string_view>{}(label->text()) ^
+               static_cast<size_t>(label->kind());
+    }
+};
+
+struct LabelTextEqual {
+    bool operator()(Label const* a, Label const* b) const {
+        return a == b || equalText(*a, *b);
     }
 };
 
-void Context::generate(Edge edge) { line(makeEdge(edge, graph.kind())); }
+static bool isLeaf(Vertex const* vertex) { return !vertex->isGraph(); }
+
+void Context::hoistNodeDefaults(Graph const& graph) {
+    auto vertices = graph.vertices() | std::views::filter(isLeaf);
+    auto const& current = writer.nodeDefaults();
+    DotWriter::NodeDefaults defaults;
+    auto [label, labelCount] = dominant(
+        vertices,
+        [](Vertex const* vertex) { return &vertex->label(); },
+        LabelTextHash{},
+        LabelTextEqual{});
+    if (labelCount >= 2 &&
+        !(current.label && equalText(*current.label, **label)))
+    {
+        defaults.label = **label;
+    }
+    auto inherited = writer.getFont(std::nullopt);
+    auto [font, fontCount] =
+        dominant(vertices, [&](Vertex const* vertex) {
+        return vertex->font().value_or(inherited);
+    });
+    if (fontCount >= 2 && current.font != font) {
+        defaults.font = font;
+    }
+    auto [shape, shapeCount] = dominant(vertices, [](Vertex const* vertex) {
+        return vertex->shape();
+    });
+    if (shapeCount >= 2 && current.shape != shape) {
+        defaults.shape = shape;
+    }
+    if (defaults.label || defaults.font || defaults.shape) {
+        writer.declareNodeDefaults(defaults);
+    }
+}
+
+void Context::coalesceEdges(Graph const& graph) {
+    auto coalesced =
+        coalescer.run(graph.edges(), writer.graphKind == GraphKind::Undirected);
+    counters.edges += coalesced.size();
+    for (auto& [edge, count]: coalesced) {
+        writer.edge(edge, count, options.coalesceEdges);
+    }
+}
+
+void Context::hoistEdgeDefaults(Graph const& graph) {
+    auto edges = graph.edges();
+    DotWriter::EdgeDefaults defaults;
+    // Edges without a value would inherit the default, so we can only hoist
+    // attributes that are set on all edges
+    if (std::ranges::all_of(edges, [](Edge const& e) { return !!e.color; })) {
+        auto [color, count] = dominant(edges, &Edge::color);
+        if (count >= 2) {
+            defaults.color = *color;
+        }
+    }
+    if (std::ranges::all_of(edges, [](Edge const& e) { return !!e.style; })) {
+        auto [style, count] = dominant(edges, &Edge::style);
+        if (count >= 2) {
+            defaults.style = *style;
+        }
+    }
+    if (defaults.color || defaults.style) {
+        writer.declareEdgeDefaults(defaults);
+    }
+}
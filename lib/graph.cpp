@@ -1,39 +1,534 @@
 #include "graphgen/graph.h"
 
-#include <iomanip>
+#include <cassert>
+#include <cstring>
+#include <limits>
 #include <ostream>
+#include <utility>
 
+#include "escape.h"
 #include "graphgen/config.h"
+#include "graphgen/sink.h"
+#include "outputcache.h"
+#include "spill.h"
+#include "util.h"
+#include "vertexindex.h"
 #include "vertexvisitor.h"
 
 using namespace graphgen;
 
-static auto makeGenerator(std::string text) {
-    return [text = std::move(text)](std::ostream& str) { str << text; };
+Label::Label(std::string_view text, LabelKind kind): _kind(kind) {
+    assert(text.size() <= std::numeric_limits<uint32_t>::max());
+    _size = static_cast<uint32_t>(text.size());
+    if (text.size() <= InlineCapacity) {
+        _storage = Storage::Inline;
+        if (!text.empty()) {
+            std::memcpy(_inline, text.data(), text.size());
+        }
+    }
+    else {
+        _storage = Storage::Owned;
+        char* buffer = new char[text.size()];
+        std::memcpy(buffer, text.data(), text.size());
+        _text = buffer;
+    }
+}
+
+Label::Label(Generator generator, LabelKind kind):
+    _kind(kind), _storage(Storage::Generator) {
+    _generator = new Generator(std::move(generator));
+}
+
+Label Label::view(std::string_view text, LabelKind kind) {
+    assert(text.size() <= std::numeric_limits<uint32_t>::max());
+    Label result;
+    result._storage = Storage::View;
+    result._text = text.data();
+    result._size = static_cast<uint32_t>(text.size());
+    result._kind = kind;
+    return result;
+}
+
+Label::Label(Label const& rhs) { copyFrom(rhs); }
+
+Label::Label(Label&& rhs) noexcept:
+    _size(rhs._size), _kind(rhs._kind), _storage(rhs._storage) {
+    std::memcpy(_inline, rhs._inline, InlineCapacity);
+    rhs._storage = Storage::Inline;
+    rhs._size = 0;
+}
+
+Label& Label::operator=(Label const& rhs) {
+    if (this != &rhs) {
+        destroy();
+        copyFrom(rhs);
+    }
+    return *this;
+}
+
+Label& Label::operator=(Label&& rhs) noexcept {
+    if (this != &rhs) {
+        destroy();
+        std::memcpy(_inline, rhs._inline, InlineCapacity);
+        _size = rhs._size;
+        _kind = rhs._kind;
+        _storage = rhs._storage;
+        rhs._storage = Storage::Inline;
+        rhs._size = 0;
+    }
+    return *this;
 }
 
-Label::Label(std::string text, LabelKind kind):
-    generator(makeGenerator(std::move(text))), _kind(kind) {}
+Label::~Label() { destroy(); }
 
-Label::Label(std::function<void(std::ostream&)> generator, LabelKind kind):
-    generator(std::move(generator)), _kind(kind) {}
+void Label::copyFrom(Label const& rhs) {
+    _size = rhs._size;
+    _kind = rhs._kind;
+    _storage = rhs._storage;
+    switch (_storage) {
+    case Storage::Inline:
+        [[fallthrough]];
+    case Storage::View:
+        std::memcpy(_inline, rhs._inline, InlineCapacity);
+        break;
+    case Storage::Owned: {
+        char* buffer = new char[_size];
+        std::memcpy(buffer, rhs._text, _size);
+        _text = buffer;
+        break;
+    }
+    case Storage::Generator:
+        _generator = new Generator(*rhs._generator);
+        break;
+    }
+}
+
+void Label::destroy() {
+    switch (_storage) {
+    case Storage::Owned:
+        delete[] _text;
+        break;
+    case Storage::Generator:
+        delete _generator;
+        break;
+    default:
+        break;
+    }
+}
+
+/// Runs \p generator into a reused buffer, so the output can be escaped as a
+/// whole. Generators that emit labels themselves get a buffer of their own
+template <typename F>
+static void withGeneratedText(Label::Generator const& generator, F&& f) {
+    thread_local BufferSink buffer;
+    thread_local bool inUse = false;
+    if (inUse) {
+        BufferSink local;
+        generator(local.ostream());
+        f(local.view());
+        return;
+    }
+    inUse = true;
+    ScopeGuard release([] { inUse = false; });
+    buffer.clear();
+    generator(buffer.ostream());
+    f(buffer.view());
+}
 
 void Label::emit(std::ostream& str) const {
     switch (kind()) {
     case LabelKind::PlainText:
         str << "\"";
-        generator(str);
+        if (isGenerated()) {
+            withGeneratedText(*_generator, [&](std::string_view text) {
+                writeEscaped(str, text);
+            });
+        }
+        else {
+            writeEscaped(str, text());
+        }
         str << "\"";
         break;
-
     case LabelKind::HTML:
         str << "<";
-        generator(str);
+        if (isGenerated()) {
+            (*_generator)(str);
+        }
+        else {
+            str << text();
+        }
         str << ">";
         break;
+    case LabelKind::Escaped:
+        str << "\"";
+        if (isGenerated()) {
+            (*_generator)(str);
+        }
+        else {
+            str << text();
+        }
+        str << "\"";
+        break;
+    }
+}
+
+void Label::emit(Sink& sink) const {
+    switch (kind()) {
+    case LabelKind::PlainText:
+        sink.put('"');
+        if (isGenerated()) {
+            withGeneratedText(*_generator, [&](std::string_view text) {
+                writeEscaped(sink, text);
+            });
+        }
+        else {
+            writeEscaped(sink, text());
+        }
+        sink.put('"');
+        break;
+
+    case LabelKind::HTML:
+        sink.put('<');
+        writeText(sink);
+        sink.put('>');
+        break;
+
+    case LabelKind::Escaped:
+        sink.put('"');
+        writeText(sink);
+        sink.put('"');
+        break;
+    }
+}
+
+void Label::writeText(Sink& sink) const {
+    if (isGenerated()) {
+        (*_generator)(sink.ostream());
+    }
+    else {
+        sink.write(text());
+    }
+}
+
+Vertex::~Vertex() {
+    if (_ownsFont) {
+        StringPool::deallocate(_font);
+    }
+}
+
+void Vertex::setFont(std::optional<std::string_view> font) {
+    // \p font may refer to the current font, so it is released last
+    InternedString previous = std::exchange(_font, InternedString());
+    bool ownedPrevious = std::exchange(_ownsFont, false);
+    if (font) {
+        if (auto* graph = asGraph()) {
+            _font = graph->strings().intern(*font);
+        }
+        else if (_parent) {
+            _font = static_cast<Graph*>(_parent)->strings().intern(*font);
+        }
+        else {
+            _font = StringPool::allocate(*font);
+            _ownsFont = true;
+        }
+    }
+    if (ownedPrevious) {
+        StringPool::deallocate(previous);
     }
 }
 
 void Vertex::visit(VertexVisitor& visitor) const { visitor.visit(*this); }
 
+Graph::Graph(ID id): Vertex(id, VertexKind::Graph) {}
+
+Graph::Graph(): Vertex(ID(this), VertexKind::Graph) {}
+
+Graph::~Graph() { releaseVertices(nullptr); }
+
+void Graph::releaseVertices(VertexIndex* index) {
+    // Subgraphs hand their children to this loop before they are destroyed,
+    // so arbitrarily deep nesting does not recurse. Arenas of subgraphs that
+    // were populated before they were added are kept until the end, because
+    // the handed over children may live in them
+    std::vector<Vertex*> pending = std::move(_vertices);
+    _vertices = {};
+    std::vector<std::unique_ptr<Arena>> arenas;
+    while (!pending.empty()) {
+        Vertex* vertex = pending.back();
+        pending.pop_back();
+        if (index) {
+            index->redirect(vertex, this);
+        }
+        if (auto* graph = vertex->asGraph()) {
+            pending.insert(pending.end(),
+                           graph->_vertices.begin(),
+                           graph->_vertices.end());
+            graph->_vertices.clear();
+            if (graph->_arena) {
+                arenas.push_back(std::move(graph->_arena));
+            }
+        }
+        if (vertex->_arenaAllocated) {
+            // The memory goes with the arena, so vertices that hold nothing
+            // else are simply dropped
+            if (!vertex->hasTrivialTeardown()) {
+                vertex->~Vertex();
+            }
+        }
+        else {
+            delete vertex;
+        }
+    }
+}
+
+Graph& Graph::root() {
+    return const_cast<Graph&>(static_cast<Graph const*>(this)->root());
+}
+
+Graph const& Graph::root() const {
+    Graph const* root = this;
+    while (root->parent()) {
+        root = static_cast<Graph const*>(root->parent());
+    }
+    return *root;
+}
+
+Vertex* Graph::find(ID id) {
+    return const_cast<Vertex*>(static_cast<Graph const*>(this)->find(id));
+}
+
+Vertex const* Graph::find(ID id) const {
+    auto& index = root()._index;
+    return index ? index->find(id) : nullptr;
+}
+
+std::span<ID const> Graph::duplicateIDs() const {
+    auto& index = root()._index;
+    return index ? index->duplicates() : std::span<ID const>{};
+}
+
+void Graph::registerVertex(Vertex* vertex) {
+    Graph& root = this->root();
+    if (!root._index) {
+        root._index = std::make_unique<VertexIndex>();
+    }
+    root._index->insert(vertex);
+    // Vertices that have been configured before they were added own a copy of
+    // their font, which moves to the pool of the tree
+    if (vertex->_ownsFont) {
+        vertex->setFont(vertex->_font.view());
+    }
+    // Subgraphs that have been populated before they were added have their
+    // own index which we absorb
+    auto* graph = vertex->asGraph();
+    if (graph && graph->_index) {
+        root._index->merge(*graph->_index);
+        graph->_index.reset();
+    }
+    // Vertices of shared graphs are found through every graph they are
+    // attached to
+    if (graph && graph->_shared && graph->_shared->_index) {
+        root._index->merge(*graph->_shared->_index);
+    }
+    if (graph && graph->_budgetInTree) {
+        root._budgetInTree = true;
+    }
+    // Subgraphs of graphs with a memory budget allocate from their own arena,
+    // so the memory can be released when they are spilled
+    if (graph && _spill && !graph->_arena) {
+        graph->_arena = std::make_unique<Arena>();
+    }
+}
+
+Arena& Graph::arena() {
+    Graph* graph = this;
+    while (!graph->_arena && graph->parent()) {
+        graph = static_cast<Graph*>(graph->parent());
+    }
+    if (!graph->_arena) {
+        graph->_arena = std::make_unique<Arena>();
+    }
+    return *graph->_arena;
+}
+
+StringPool& Graph::strings() {
+    Graph& root = this->root();
+    if (!root._strings) {
+        root._strings = std::make_unique<StringPool>();
+    }
+    return *root._strings;
+}
+
+Graph* Graph::memoryBudget(size_t bytes, std::filesystem::path directory) {
+    if (directory.empty()) {
+        directory = std::filesystem::temp_directory_path();
+    }
+    if (!_spill) {
+        _spill = std::make_unique<SpillState>();
+    }
+    _spill->budget = bytes;
+    _spill->directory = std::move(directory);
+    root()._budgetInTree = true;
+    return this;
+}
+
+std::optional<size_t> Graph::memoryBudget() const {
+    if (!_spill) {
+        return std::nullopt;
+    }
+    return _spill->budget;
+}
+
+Graph* Graph::finish() {
+    auto* parent = this->parent() ? this->parent()->asGraph() : nullptr;
+    // Shared vertices are not owned by this graph, so spilling them would not
+    // release any memory
+    if (!parent || !parent->_spill || _isFinished || _shared) {
+        return this;
+    }
+    _isFinished = true;
+    auto& state = *parent->_spill;
+    size_t size = footprint();
+    state.finished.push_back({ this, size });
+    state.resident += size;
+    while (state.resident > state.budget && !state.finished.empty()) {
+        auto [graph, size] = state.finished.front();
+        state.finished.pop_front();
+        state.resident -= size;
+        graph->spill(state);
+    }
+    return this;
+}
+
+size_t Graph::footprint() const {
+    size_t size = 0;
+    std::vector<Graph const*> pending = { this };
+    while (!pending.empty()) {
+        Graph const* graph = pending.back();
+        pending.pop_back();
+        if (graph->_arena) {
+            size += graph->_arena->capacity();
+        }
+        size += graph->_vertices.capacity() * sizeof(Vertex*) +
+                graph->_edgeFrom.capacity() * sizeof(ID) +
+                graph->_edgeTo.capacity() * sizeof(ID) +
+                graph->_edgeAttributes.capacity() * sizeof(EdgeAttributes);
+        for (Vertex const* vertex: graph->_vertices) {
+            if (!vertex->_arenaAllocated) {
+                size += vertex->isGraph() ? sizeof(Graph) : sizeof(Vertex);
+            }
+            size += vertex->label().heapSize();
+            if (auto* subgraph = vertex->asGraph()) {
+                pending.push_back(subgraph);
+            }
+        }
+    }
+    return size;
+}
+
+void Graph::spill(SpillState& state) {
+    if (!state.file) {
+        state.file = std::make_unique<SpillFile>(state.directory);
+    }
+    _segment = std::make_unique<SpillSegment>(state.file->write(*this));
+    releaseVertices(root()._index.get());
+    _edgeFrom = {};
+    _edgeTo = {};
+    _edgeAttributes = {};
+    _cachedOutput.reset();
+    _arena.reset();
+}
+
+std::unique_ptr<Graph> Graph::readSpilled() const {
+    if (!_segment) {
+        return nullptr;
+    }
+    auto& state = *static_cast<Graph const*>(parent())->_spill;
+    auto result = state.file->read(*_segment);
+    result->setParent(const_cast<Vertex*>(parent()));
+    return result;
+}
+
+/// Copies the attributes of \p from to \p to. Label text is copied, because
+/// labels of shared graphs may refer to strings owned by the shared graph
+static void copyAttributes(Vertex const& from, Vertex& to) {
+    auto& label = from.label();
+    to.label(label.isGenerated() ? label : Label(label.text(), label.kind()))
+        ->shape(from.shape())
+        ->font(from.font())
+        ->color(from.color())
+        ->style(from.style());
+}
+
+Graph* Graph::addShared(std::shared_ptr<Graph const> graph) {
+    assert(!graph->parent() && "Only roots can be shared");
+    assert(!find(graph->id()) && "Graphs can be shared once per tree");
+    auto* result = arena().create<Graph>(graph->id());
+    result->_arenaAllocated = true;
+    result->_label = graph->_label;
+    result->_shape = graph->_shape;
+    result->_font = graph->_font;
+    result->_color = graph->_color;
+    result->_style = graph->_style;
+    result->_kind = graph->_kind;
+    result->_rankDir = graph->_rankDir;
+    result->_shared = std::move(graph);
+    add(result);
+    return result;
+}
+
+Graph* Graph::unshare() {
+    if (!_shared) {
+        return this;
+    }
+    // The reference is released last, because the copies are made from it
+    auto shared = std::move(_shared);
+    copyAttributes(*this, *this);
+    VertexIndex* index = root()._index.get();
+    Arena& arena = this->arena();
+    struct Frame {
+        Graph const* from;
+        Graph* to;
+    };
+    std::vector<Frame> pending = { { shared.get(), this } };
+    while (!pending.empty()) {
+        auto [from, to] = pending.back();
+        pending.pop_back();
+        to->_vertices.reserve(from->_vertices.size());
+        for (Vertex const* vertex: from->_vertices) {
+            auto* graph = vertex->asGraph();
+            Vertex* copy = graph ? arena.create<Graph>(vertex->id()) :
+                                   arena.create<Vertex>(vertex->id());
+            if (graph) {
+                copy->setArenaAllocated<Graph>();
+            }
+            else {
+                copy->setArenaAllocated<Vertex>();
+            }
+            copyAttributes(*vertex, *copy);
+            if (graph) {
+                auto* subgraph = static_cast<Graph*>(copy);
+                subgraph->_kind = graph->_kind;
+                subgraph->_rankDir = graph->_rankDir;
+                if (graph->_shared) {
+                    subgraph->_shared = graph->_shared;
+                }
+                else {
+                    pending.push_back({ graph, subgraph });
+                }
+            }
+            copy->setParent(to);
+            to->_vertices.push_back(copy);
+            if (index) {
+                index->redirect(vertex, copy);
+            }
+        }
+        to->_edgeFrom = from->_edgeFrom;
+        to->_edgeTo = from->_edgeTo;
+        to->_edgeAttributes = from->_edgeAttributes;
+    }
+    markDirty();
+    return this;
+}
+
 void Graph::visit(VertexVisitor& visitor) const { visitor.visit(*this); }
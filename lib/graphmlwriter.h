@@ -0,0 +1,167 @@
+#ifndef GRAPHGEN_GRAPHMLWRITER_H_
+#define GRAPHGEN_GRAPHMLWRITER_H_
+
+#include <chrono>
+#include <string_view>
+
+#include "dotwriter.h"
+#include "escape.h"
+#include "graphgen/graph.h"
+#include "graphgen/sink.h"
+#include "idmap.h"
+
+namespace graphgen {
+
+/// Writer policy of `generate<Format::GraphML>()`. Vertices become `node`
+/// elements and subgraphs become `node` elements with a nested `graph`.
+/// Attributes are written as `data` elements whose keys are declared in the
+/// header. Edges are declared in the graph they belong to
+class GraphMLWriter {
+public:
+    GraphMLWriter(Sink& str, Graph const& root, IDMap<size_t> const* names):
+        str(str), root(root), names(names) {}
+
+    void beginDocument() {
+        str << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+               "<graphml xmlns=\"http://graphml.graphdrawing.org/xmlns\">\n";
+        key("label", "all", "string");
+        key("html", "all", "boolean");
+        key("shape", "node", "string");
+        key("fontname", "node", "string");
+        key("color", "all", "string");
+        key("style", "all", "string");
+        key("count", "edge", "int");
+        ++depth;
+        indent();
+        str << "<graph id=\"G\"";
+        openGraph(root);
+    }
+
+    void endDocument() {
+        closeGraph();
+        str << "</graphml>\n";
+    }
+
+    void beginGraph(Graph const& graph) {
+        openNode(graph);
+        indent();
+        str << "<graph id=\"" << VertexName{ graph.id(), names } << ":\"";
+        openGraph(graph);
+    }
+
+    void endGraph(Graph const&) {
+        closeGraph();
+        closeNode();
+    }
+
+    void vertex(Vertex const& vertex) {
+        openNode(vertex);
+        closeNode();
+    }
+
+    /// Writes \p edge which stands for \p count equal edges
+    void edge(Edge const& edge, size_t count) {
+        indent();
+        str << "<edge source=\"" << VertexName{ edge.from, names }
+            << "\" target=\"" << VertexName{ edge.to, names } << '"';
+        if (!edge.color && !edge.style && count < 2) {
+            str << "/>\n";
+            return;
+        }
+        str << ">\n";
+        ++depth;
+        if (edge.color) {
+            data("color", toString(*edge.color));
+        }
+        if (edge.style) {
+            data("style", toString(*edge.style));
+        }
+        if (count > 1) {
+            indent();
+            str << "<data key=\"count\">" << count << "</data>\n";
+        }
+        --depth;
+        indent();
+        str << "</edge>\n";
+    }
+
+    /// If not null, the time spent in label generators is added here
+    std::chrono::nanoseconds* generatorTime = nullptr;
+
+private:
+    void indent() { writeSpaces(str, static_cast<size_t>(depth) * 2); }
+
+    void key(char const* name, char const* domain, char const* type) {
+        str << "  <key id=\"" << name << "\" for=\"" << domain
+            << "\" attr.name=\"" << name << "\" attr.type=\"" << type
+            << "\"/>\n";
+    }
+
+    /// Writes \p value as `data` element with key \p name
+    void data(char const* name, std::string_view value) {
+        indent();
+        str << "<data key=\"" << name << "\">";
+        writeXMLEscaped(str, value);
+        str << "</data>\n";
+    }
+
+    /// Completes the open `graph` tag of \p graph and writes its label
+    void openGraph(Graph const& graph) {
+        str << " edgedefault=\""
+            << (root.kind() == GraphKind::Undirected ? "undirected" :
+                                                       "directed")
+            << "\">\n";
+        ++depth;
+        label(graph.label());
+    }
+
+    void closeGraph() {
+        --depth;
+        indent();
+        str << "</graph>\n";
+    }
+
+    /// Opens the `node` element of \p vertex and writes its attributes
+    void openNode(Vertex const& vertex) {
+        indent();
+        str << "<node id=\"" << VertexName{ vertex.id(), names } << "\">\n";
+        ++depth;
+        label(vertex.label());
+        data("shape", toString(vertex.shape()));
+        if (auto font = vertex.font()) {
+            data("fontname", *font);
+        }
+        if (vertex.color()) {
+            data("color", toString(*vertex.color()));
+        }
+        if (vertex.style()) {
+            data("style", toString(*vertex.style()));
+        }
+    }
+
+    void closeNode() {
+        --depth;
+        indent();
+        str << "</node>\n";
+    }
+
+    void label(Label const& label) {
+        if (!label.isGenerated() && label.text().empty()) {
+            return;
+        }
+        data("label", labelText(label, buffer, generatorTime));
+        if (label.kind() == LabelKind::HTML) {
+            data("html", "true");
+        }
+    }
+
+    Sink& str;
+    Graph const& root;
+    IDMap<size_t> const* names;
+    BufferSink buffer;
+    int depth = 0;
+};
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_GRAPHMLWRITER_H_
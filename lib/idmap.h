@@ -0,0 +1,120 @@
+#ifndef GRAPHGEN_IDMAP_H_
+#define GRAPHGEN_IDMAP_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "graphgen/graph.h"
+
+namespace graphgen {
+
+/// Open addressing hash map from vertex IDs to values of type `T` with linear
+/// probing. Entries cannot be removed
+template <typename T>
+class IDMap {
+public:
+    /// \Returns a pointer to the value of \p id or null if \p id is not in the
+    /// map
+    T const* find(ID id) const {
+        if (slots.empty()) {
+            return nullptr;
+        }
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash(id.raw()) & mask;; i = (i + 1) & mask) {
+            auto& slot = slots[i];
+            if (!slot.used) {
+                return nullptr;
+            }
+            if (slot.key == id.raw()) {
+                return &slot.value;
+            }
+        }
+    }
+
+    /// \overload for non-const
+    T* find(ID id) {
+        return const_cast<T*>(static_cast<IDMap const*>(this)->find(id));
+    }
+
+    /// Inserts \p value for \p id if \p id is not in the map yet. \Returns a
+    /// pointer to the value in the map and `true` if it has been inserted
+    std::pair<T*, bool> insert(ID id, T value) {
+        // Keep the load factor below 1/2 so probe sequences stay short
+        if ((count + 1) * 2 > slots.size()) {
+            grow();
+        }
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash(id.raw()) & mask;; i = (i + 1) & mask) {
+            auto& slot = slots[i];
+            if (!slot.used) {
+                slot = { id.raw(), std::move(value), true };
+                ++count;
+                return { &slot.value, true };
+            }
+            if (slot.key == id.raw()) {
+                return { &slot.value, false };
+            }
+        }
+    }
+
+    /// Reserves space for \p size entries
+    void reserve(size_t size) {
+        while (size * 2 > slots.size()) {
+            grow();
+        }
+    }
+
+    /// Invokes \p f with the ID and value of every entry in unspecified order
+    template <typename F>
+    void forEach(F&& f) const {
+        for (auto& slot: slots) {
+            if (slot.used) {
+                f(ID(slot.key), slot.value);
+            }
+        }
+    }
+
+    /// \Returns the number of entries
+    size_t size() const { return count; }
+
+private:
+    struct Slot {
+        uintptr_t key = 0;
+        T value{};
+        bool used = false;
+    };
+
+    /// Pointer derived IDs have their low bits clear, so we mix all bits
+    static size_t hash(uintptr_t key) {
+        uint64_t x = key;
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdull;
+        x ^= x >> 33;
+        return static_cast<size_t>(x);
+    }
+
+    void grow() {
+        std::vector<Slot> old = std::move(slots);
+        slots.assign(old.empty() ? 16 : old.size() * 2, Slot{});
+        size_t mask = slots.size() - 1;
+        for (auto& slot: old) {
+            if (!slot.used) {
+                continue;
+            }
+            for (size_t i = hash(slot.key) & mask;; i = (i + 1) & mask) {
+                if (!slots[i].used) {
+                    slots[i] = std::move(slot);
+                    break;
+                }
+            }
+        }
+    }
+
+    std::vector<Slot> slots;
+    size_t count = 0;
+};
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_IDMAP_H_
@@ -0,0 +1,45 @@
+#include "graphgen/intern.h"
+
+using namespace graphgen;
+
+/// Copies \p text with its size in front to \p memory, which must hold
+/// `sizeof(uint32_t) + text.size() + 1` bytes. \Returns the copy
+static char const* store(char* memory, std::string_view text) {
+    auto size = static_cast<uint32_t>(text.size());
+    std::memcpy(memory, &size, sizeof(uint32_t));
+    char* data = memory + sizeof(uint32_t);
+    std::memcpy(data, text.data(), text.size());
+    data[text.size()] = '\0';
+    return data;
+}
+
+InternedString StringPool::intern(std::string_view text) {
+    std::lock_guard lock(mutex);
+    auto itr = strings.find(text);
+    if (itr != strings.end()) {
+        return InternedString(itr->data());
+    }
+    // Strings are stored with their size in front so handles only need a
+    // single pointer
+    auto* memory = static_cast<char*>(
+        arena.allocate(sizeof(uint32_t) + text.size() + 1, alignof(uint32_t)));
+    char const* data = store(memory, text);
+    strings.insert(std::string_view(data, text.size()));
+    return InternedString(data);
+}
+
+size_t StringPool::size() const {
+    std::lock_guard lock(mutex);
+    return strings.size();
+}
+
+InternedString StringPool::allocate(std::string_view text) {
+    auto* memory = new char[sizeof(uint32_t) + text.size() + 1];
+    return InternedString(store(memory, text));
+}
+
+void StringPool::deallocate(InternedString string) {
+    if (string) {
+        delete[] (string._data - sizeof(uint32_t));
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef GRAPHGEN_JSONWRITER_H_
+#define GRAPHGEN_JSONWRITER_H_
+
+#include <chrono>
+#include <string_view>
+
+#include "dotwriter.h"
+#include "escape.h"
+#include "graphgen/graph.h"
+#include "graphgen/sink.h"
+#include "idmap.h"
+
+namespace graphgen {
+
+/// Writer policy of `generate<Format::Json>()`. The graph is written in the
+/// element format of Cytoscape.js. Vertices and subgraphs become node
+/// elements whose `parent` is the enclosing subgraph, edges become edge
+/// elements:
+/// ```
+///  {"directed":true,"elements":[
+///  {"group":"nodes","data":{"id":"vertex_1","label":"A","shape":"box"}},
+///  {"group":"edges","data":{"source":"vertex_1","target":"vertex_2"}}
+///  ]}
+/// ```
+class JsonWriter {
+public:
+    JsonWriter(Sink& str, Graph const& root, IDMap<size_t> const* names):
+        str(str), root(root), names(names) {}
+
+    void beginDocument() {
+        str << "{\"directed\":"
+            << (root.kind() == GraphKind::Undirected ? "false" : "true");
+        if (root.label().isGenerated() || !root.label().text().empty()) {
+            str << ",\"data\":{";
+            label(root.label());
+            str.put('}');
+        }
+        str << ",\"elements\":[";
+    }
+
+    void endDocument() { str << "\n]}\n"; }
+
+    void beginGraph(Graph const& graph) { node(graph); }
+
+    void endGraph(Graph const&) {}
+
+    void vertex(Vertex const& vertex) { node(vertex); }
+
+    /// Writes \p edge which stands for \p count equal edges
+    void edge(Edge const& edge, size_t count) {
+        open("edges");
+        str << "\"source\":\"" << VertexName{ edge.from, names }
+            << "\",\"target\":\"" << VertexName{ edge.to, names } << '"';
+        if (edge.color) {
+            str << ",\"color\":\"" << toString(*edge.color) << '"';
+        }
+        if (edge.style) {
+            str << ",\"style\":\"" << toString(*edge.style) << '"';
+        }
+        if (count > 1) {
+            str << ",\"count\":" << count;
+        }
+        str << "}}";
+    }
+
+    /// If not null, the time spent in label generators is added here
+    std::chrono::nanoseconds* generatorTime = nullptr;
+
+private:
+    /// Opens an element of group \p group and its `data` object
+    void open(char const* group) {
+        str << (first ? "\n" : ",\n") << "{\"group\":\"" << group
+            << "\",\"data\":{";
+        first = false;
+    }
+
+    void node(Vertex const& vertex) {
+        open("nodes");
+        str << "\"id\":\"" << VertexName{ vertex.id(), names } << '"';
+        if (vertex.parent() && vertex.parent() != &root) {
+            str << ",\"parent\":\"" << VertexName{ vertex.parent()->id(), names }
+                << '"';
+        }
+        if (vertex.label().isGenerated() || !vertex.label().text().empty()) {
+            str.put(',');
+            label(vertex.label());
+        }
+        str << ",\"shape\":\"" << toString(vertex.shape()) << '"';
+        if (auto font = vertex.font()) {
+            str << ",\"fontname\":\"";
+            writeJSONEscaped(str, *font);
+            str.put('"');
+        }
+        if (vertex.color()) {
+            str << ",\"color\":\"" << toString(*vertex.color()) << '"';
+        }
+        if (vertex.style()) {
+            str << ",\"style\":\"" << toString(*vertex.style()) << '"';
+        }
+        str << "}}";
+    }
+
+    void label(Label const& label) {
+        str << "\"label\":\"";
+        writeJSONEscaped(str, labelText(label, buffer, generatorTime));
+        str.put('"');
+        if (label.kind() == LabelKind::HTML) {
+            str << ",\"html\":true";
+        }
+    }
+
+    Sink& str;
+    Graph const& root;
+    IDMap<size_t> const* names;
+    BufferSink buffer;
+    bool first = true;
+};
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_JSONWRITER_H_
@@ -0,0 +1,70 @@
+#include "mappedfile.h"
+
+#include <cerrno>
+#include <system_error>
+
+#if defined(_WIN32)
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "util.h"
+
+using namespace graphgen;
+
+static std::system_error openError(std::filesystem::path const& path) {
+    return std::system_error(errno,
+                             std::generic_category(),
+                             "Failed to map " + path.string());
+}
+
+MappedFile::MappedFile(std::filesystem::path const& path) {
+#if defined(_WIN32)
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        throw openError(path);
+    }
+    _buffer.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+    if (!file) {
+        throw openError(path);
+    }
+    _data = _buffer.data();
+    _size = _buffer.size();
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw openError(path);
+    }
+    ScopeGuard closeFD([&] { ::close(fd); });
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        throw openError(path);
+    }
+    if (info.st_size == 0) {
+        return;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED) {
+        throw openError(path);
+    }
+    // Snapshots and DOT files are mostly read front to back
+    ::madvise(address, size, MADV_SEQUENTIAL);
+    _data = static_cast<char const*>(address);
+    _size = size;
+#endif
+}
+
+MappedFile::~MappedFile() {
+#if !defined(_WIN32)
+    if (_data) {
+        ::munmap(const_cast<char*>(_data), _size);
+    }
+#endif
+}
@@ -0,0 +1,42 @@
+#ifndef GRAPHGEN_MAPPEDFILE_H_
+#define GRAPHGEN_MAPPEDFILE_H_
+
+#include <cstddef>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+namespace graphgen {
+
+/// Read-only view of the contents of a file. On POSIX systems the file is
+/// memory mapped, elsewhere it is read into a buffer. The data is aligned to
+/// at least 8 bytes
+class MappedFile {
+public:
+    /// Maps the file at \p path. Throws `std::system_error` on failure
+    explicit MappedFile(std::filesystem::path const& path);
+
+    MappedFile(MappedFile const&) = delete;
+
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    ~MappedFile();
+
+    /// \Returns the contents of the file
+    std::string_view text() const { return { _data, _size }; }
+
+    char const* data() const { return _data; }
+
+    size_t size() const { return _size; }
+
+private:
+    char const* _data = nullptr;
+    size_t _size = 0;
+#if defined(_WIN32)
+    std::vector<char> _buffer;
+#endif
+};
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_MAPPEDFILE_H_
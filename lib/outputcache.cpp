@@ -0,0 +1,100 @@
+#include "outputcache.h"
+
+#include <mutex>
+
+using namespace graphgen;
+
+/// Guards the shared caches of all graphs. Shared graphs may be attached to
+/// graphs that are generated on different threads
+static std::mutex sharedMutex;
+
+OutputKey::OutputKey(int indent,
+                     bool isRoot,
+                     bool hoistDefaults,
+                     EdgeCoalescing coalesceEdges,
+                     GraphKind graphKind,
+                     std::optional<std::string_view> font,
+                     DotWriter::NodeDefaults const& defaults):
+    indent(indent),
+    isRoot(isRoot),
+    hoistDefaults(hoistDefaults),
+    coalesceEdges(coalesceEdges),
+    graphKind(graphKind),
+    font(font),
+    defaultFont(defaults.font),
+    defaultShape(defaults.shape) {
+    if (defaults.label) {
+        defaultLabel.emplace(std::string(defaults.label->text()),
+                             defaults.label->kind());
+    }
+}
+
+Fragment::~Fragment() {
+    std::vector<std::unique_ptr<Fragment>> pending;
+    auto release = [&](Fragment& fragment) {
+        for (auto& child: fragment.children) {
+            if (child.owned) {
+                pending.push_back(std::move(child.owned));
+            }
+        }
+    };
+    release(*this);
+    while (!pending.empty()) {
+        auto fragment = std::move(pending.back());
+        pending.pop_back();
+        release(*fragment);
+    }
+}
+
+Fragment const* OutputCache::find(Graph const& graph, OutputKey const& key) {
+    auto const& cached = graph._cachedOutput;
+    if (graph._dirty || !cached || cached->fragment->key != key) {
+        return nullptr;
+    }
+    return cached->fragment.get();
+}
+
+void OutputCache::store(std::unique_ptr<Fragment> fragment) {
+    Graph const& graph = *fragment->graph;
+    if (!graph._cachedOutput) {
+        graph._cachedOutput = std::make_unique<CachedOutput>();
+    }
+    else if (graph._parent) {
+        graph._parent->markDirty();
+    }
+    graph._cachedOutput->fragment = std::move(fragment);
+    graph._dirty = false;
+}
+
+/// \Returns the entry of \p key in \p cached or null
+static Fragment const* findKey(CachedOutput const* cached,
+                               OutputKey const& key) {
+    if (!cached) {
+        return nullptr;
+    }
+    for (auto& fragment: cached->shared) {
+        if (fragment->key == key) {
+            return fragment.get();
+        }
+    }
+    return nullptr;
+}
+
+Fragment const* OutputCache::findShared(Graph const& graph,
+                                        OutputKey const& key) {
+    std::lock_guard lock(sharedMutex);
+    return findKey(graph._cachedOutput.get(), key);
+}
+
+Fragment const* OutputCache::storeShared(Graph const& graph,
+                                         std::unique_ptr<Fragment> fragment) {
+    std::lock_guard lock(sharedMutex);
+    if (auto* cached = findKey(graph._cachedOutput.get(), fragment->key)) {
+        return cached;
+    }
+    if (!graph._cachedOutput) {
+        graph._cachedOutput = std::make_unique<CachedOutput>();
+    }
+    graph._cachedOutput->shared.push_back(std::move(fragment));
+    return graph._cachedOutput->shared.back().get();
+}
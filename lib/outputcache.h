@@ -0,0 +1,116 @@
+#ifndef GRAPHGEN_OUTPUTCACHE_H_
+#define GRAPHGEN_OUTPUTCACHE_H_
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "dotwriter.h"
+#include "graphgen/graph.h"
+#include "graphgen/sink.h"
+
+namespace graphgen {
+
+/// Everything outside of a graph that affects the code generated for it.
+/// Cached output is only reused if it has been generated with an equal key
+struct OutputKey {
+    int indent = 0;
+    bool isRoot = false;
+    bool hoistDefaults = false;
+    EdgeCoalescing coalesceEdges{};
+    GraphKind graphKind{};
+
+    /// Inherited font. Fonts are copied, because the cached code of shared
+    /// graphs may outlive the trees the fonts are interned in
+    std::optional<std::string> font;
+
+    /// Inherited node defaults. The label is copied because label views may
+    /// not outlive the generation
+    std::optional<std::pair<std::string, LabelKind>> defaultLabel;
+    std::optional<std::string> defaultFont;
+    std::optional<VertexShape> defaultShape;
+
+    OutputKey() = default;
+
+    OutputKey(int indent,
+              bool isRoot,
+              bool hoistDefaults,
+              EdgeCoalescing coalesceEdges,
+              GraphKind graphKind,
+              std::optional<std::string_view> font,
+              DotWriter::NodeDefaults const& defaults);
+
+    bool operator==(OutputKey const&) const = default;
+};
+
+/// Generated code of a graph. The code of nested subgraphs is not copied into
+/// the parent, it is spliced in at the recorded offsets when the fragment is
+/// written. Fragments are the unit of work of parallel generation and the
+/// unit of caching of incremental generation
+struct Fragment {
+    struct Child {
+        /// Offset into the text of the parent
+        size_t offset;
+
+        /// Set if the child is owned by the parent
+        std::unique_ptr<Fragment> owned;
+
+        /// The child fragment. This is either `owned` or the cached fragment
+        /// of the subgraph
+        Fragment const* fragment;
+    };
+
+    Fragment() = default;
+
+    /// Destroys owned descendants iteratively, so deeply nested graphs do
+    /// not overflow the stack
+    ~Fragment();
+
+    BufferSink text;
+    std::vector<Child> children;
+
+    /// Set in incremental mode. The graph and context the fragment has been
+    /// generated for
+    Graph const* graph = nullptr;
+    OutputKey key;
+};
+
+/// Code generated for a graph by a previous incremental generation
+struct CachedOutput {
+    std::unique_ptr<Fragment> fragment;
+
+    /// Code of a shared graph for every key it has been generated with.
+    /// Entries are never replaced, because fragments of all graphs the shared
+    /// graph is attached to may refer to them
+    std::vector<std::unique_ptr<Fragment>> shared;
+};
+
+/// Accessor for the output cache of graphs
+class OutputCache {
+public:
+    /// \Returns the cached code of \p graph if the graph is clean and the code
+    /// has been generated with \p key, otherwise null
+    static Fragment const* find(Graph const& graph, OutputKey const& key);
+
+    /// Caches \p fragment as the code of its graph and marks the graph as
+    /// clean. Replacing the code of a graph invalidates the code of the
+    /// enclosing graphs, because they refer to it
+    static void store(std::unique_ptr<Fragment> fragment);
+
+    /// \Returns the code of the shared graph \p graph that has been generated
+    /// with \p key or null. Shared graphs are immutable, so cached code never
+    /// becomes stale. This may be called concurrently
+    static Fragment const* findShared(Graph const& graph, OutputKey const& key);
+
+    /// Caches \p fragment as the code of the shared graph \p graph unless
+    /// code with the same key has been cached concurrently. \Returns the
+    /// cached code. This may be called concurrently
+    static Fragment const* storeShared(Graph const& graph,
+                                       std::unique_ptr<Fragment> fragment);
+};
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_OUTPUTCACHE_H_
@@ -0,0 +1,804 @@
+#include "graphgen/reader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include "dotwriter.h"
+#include "idmap.h"
+#include "mappedfile.h"
+
+using namespace graphgen;
+
+DotSyntaxError::DotSyntaxError(std::string const& message,
+                               size_t line,
+                               size_t column):
+    std::runtime_error("Syntax error at " + std::to_string(line) + ":" +
+                       std::to_string(column) + ": " + message),
+    _line(line),
+    _column(column) {}
+
+namespace {
+
+enum class TokenKind {
+    Identifier,
+    String,
+    HTML,
+    LBrace,
+    RBrace,
+    LBracket,
+    RBracket,
+    Equals,
+    Comma,
+    Semicolon,
+    Colon,
+    EdgeOp,
+    End
+};
+
+struct Token {
+    TokenKind kind;
+
+    /// Text of the token. Quotes and the outer angle brackets of HTML strings
+    /// are not included
+    std::string_view text;
+
+    /// Position of the first character of the token in the input
+    char const* pos;
+
+    /// Set if `text` is a string containing backslash escapes
+    bool escaped = false;
+};
+
+/// Tokenizer for DOT code. This scans the input with pointer arithmetic and
+/// `memchr`, tokens refer to the input without copying
+class Lexer {
+public:
+    explicit Lexer(std::string_view input):
+        begin(input.data()), cur(input.data()), end(cur + input.size()) {}
+
+    Token next();
+
+    [[noreturn]] void error(char const* pos, std::string const& message) const;
+
+private:
+    void skipTrivia();
+    Token lexString();
+    Token lexHTML();
+    Token lexIdentifier();
+
+    char const* begin;
+    char const* cur;
+    char const* end;
+};
+
+/// Attribute values that graphgen understands. Values of the same statement
+/// or of `node [...]` and `edge [...]` defaults are collected here before they
+/// are applied
+struct Attributes {
+    std::optional<Label> label;
+    std::optional<std::string_view> font;
+    std::optional<VertexShape> shape;
+    std::optional<Color> color;
+    std::optional<Style> style;
+    std::optional<RankDir> rankdir;
+
+    /// Overrides the values of this set with the set values of \p rhs
+    void overlay(Attributes const& rhs);
+
+    /// Sets the vertex attributes on \p vertex
+    template <typename V>
+    void apply(V* vertex) const;
+};
+
+struct Scope {
+    Graph* graph;
+    Attributes nodeDefaults;
+    Attributes edgeDefaults;
+};
+
+/// A vertex that has been referenced by an edge before it was declared
+struct EdgeEndpoint {
+    Graph* graph;
+    ID id;
+    std::string_view name;
+    Attributes nodeDefaults;
+};
+
+/// Recursive descent parser for DOT code. Nested graphs are kept in an
+/// explicit stack of scopes, so deeply nested input does not overflow the
+/// call stack
+class Parser {
+public:
+    Parser(std::string_view input,
+           bool copyText,
+           std::unordered_map<std::string_view, ID>& names):
+        input(input), lexer(input), copyText(copyText), names(names) {}
+
+    std::unique_ptr<Graph> parse();
+
+private:
+    void advance() { tok = lexer.next(); }
+
+    bool isKeyword(std::string_view keyword) const;
+
+    Token expect(TokenKind kind, char const* what);
+
+    void parseBody();
+    void parseStatement(std::vector<Scope>& scopes);
+    void parseSubgraph(std::vector<Scope>& scopes);
+    void parseEdges(Scope& scope, Token first);
+    void parseNode(Scope& scope, Token name);
+    void skipPort();
+    void parseAttributeLists(Attributes& attributes);
+    void setAttribute(Attributes& attributes, Token key, Token value);
+    void setGraphAttributes(Graph* graph, Attributes const& attributes);
+
+    /// \Returns the text of the string token \p token with escapes resolved
+    std::string_view unescape(Token const& token);
+
+    /// \Returns the ID of the vertex named \p name
+    ID idFor(std::string_view name);
+
+    /// \Returns a new ID for a vertex or graph without a `vertex_<n>` name
+    ID makeID() { return nextID++; }
+
+    Label makeLabel(std::string_view text, LabelKind kind) const {
+        return copyText ? Label(text, kind) : Label::view(text, kind);
+    }
+
+    std::string_view input;
+    Lexer lexer;
+    Token tok{};
+    bool copyText;
+    std::unordered_map<std::string_view, ID>& names;
+    Graph* root = nullptr;
+    uintptr_t nextID = 0;
+    std::vector<EdgeEndpoint> undeclared;
+    IDMap<bool> undeclaredIDs;
+};
+
+} // namespace
+
+static bool isIdentifierChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '_' || c == '.' ||
+           static_cast<unsigned char>(c) >= 0x80;
+}
+
+void Lexer::error(char const* pos, std::string const& message) const {
+    size_t line = 1 + static_cast<size_t>(std::count(begin, pos, '\n'));
+    auto* lineBegin = pos;
+    while (lineBegin != begin && lineBegin[-1] != '\n') {
+        --lineBegin;
+    }
+    throw DotSyntaxError(message,
+                         line,
+                         static_cast<size_t>(pos - lineBegin) + 1);
+}
+
+void Lexer::skipTrivia() {
+    while (cur != end) {
+        switch (*cur) {
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+            ++cur;
+            break;
+        case '#':
+            cur = static_cast<char const*>(std::memchr(cur, '\n', end - cur));
+            cur = cur ? cur : end;
+            break;
+        case '/':
+            if (end - cur >= 2 && cur[1] == '/') {
+                cur = static_cast<char const*>(
+                    std::memchr(cur, '\n', end - cur));
+                cur = cur ? cur : end;
+                break;
+            }
+            if (end - cur >= 2 && cur[1] == '*') {
+                auto* commentEnd = std::search(cur + 2, end, "*/", "*/" + 2);
+                if (commentEnd == end) {
+                    error(cur, "Unterminated comment");
+                }
+                cur = commentEnd + 2;
+                break;
+            }
+            return;
+        default:
+            return;
+        }
+    }
+}
+
+Token Lexer::next() {
+    skipTrivia();
+    if (cur == end) {
+        return { TokenKind::End, {}, cur };
+    }
+    auto single = [&](TokenKind kind) {
+        Token token{ kind, { cur, 1 }, cur };
+        ++cur;
+        return token;
+    };
+    switch (*cur) {
+    case '{':
+        return single(TokenKind::LBrace);
+    case '}':
+        return single(TokenKind::RBrace);
+    case '[':
+        return single(TokenKind::LBracket);
+    case ']':
+        return single(TokenKind::RBracket);
+    case '=':
+        return single(TokenKind::Equals);
+    case ',':
+        return single(TokenKind::Comma);
+    case ';':
+        return single(TokenKind::Semicolon);
+    case ':':
+        return single(TokenKind::Colon);
+    case '"':
+        return lexString();
+    case '<':
+        return lexHTML();
+    case '-':
+        if (end - cur >= 2 && (cur[1] == '>' || cur[1] == '-')) {
+            Token token{ TokenKind::EdgeOp, { cur, 2 }, cur };
+            cur += 2;
+            return token;
+        }
+        return lexIdentifier();
+    default:
+        if (isIdentifierChar(*cur)) {
+            return lexIdentifier();
+        }
+        error(cur, std::string("Unexpected character '") + *cur + "'");
+    }
+}
+
+Token Lexer::lexString() {
+    char const* start = cur;
+    char const* first = cur + 1;
+    // Fast path: find the closing quote and check that there are no escapes
+    // in between
+    auto* quote =
+        static_cast<char const*>(std::memchr(first, '"', end - first));
+    if (!quote) {
+        error(start, "Unterminated string");
+    }
+    if (!std::memchr(first, '\\', quote - first)) {
+        cur = quote + 1;
+        return { TokenKind::String, { first, quote }, start };
+    }
+    char const* p = first;
+    while (p != end && *p != '"') {
+        p += (*p == '\\' && p + 1 != end) ? 2 : 1;
+    }
+    if (p == end) {
+        error(start, "Unterminated string");
+    }
+    cur = p + 1;
+    return { TokenKind::String, { first, p }, start, true };
+}
+
+Token Lexer::lexHTML() {
+    char const* start = cur;
+    int depth = 0;
+    for (char const* p = cur; p != end; ++p) {
+        if (*p == '<') {
+            ++depth;
+        }
+        else if (*p == '>' && --depth == 0) {
+            cur = p + 1;
+            return { TokenKind::HTML, { start + 1, p }, start };
+        }
+    }
+    error(start, "Unterminated HTML string");
+}
+
+Token Lexer::lexIdentifier() {
+    char const* start = cur;
+    ++cur;
+    while (cur != end && isIdentifierChar(*cur)) {
+        ++cur;
+    }
+    return { TokenKind::Identifier, { start, cur }, start };
+}
+
+void Attributes::overlay(Attributes const& rhs) {
+    auto set = [](auto& lhs, auto const& rhs) {
+        if (rhs) {
+            lhs = rhs;
+        }
+    };
+    set(label, rhs.label);
+    set(font, rhs.font);
+    set(shape, rhs.shape);
+    set(color, rhs.color);
+    set(style, rhs.style);
+    set(rankdir, rhs.rankdir);
+}
+
+template <typename V>
+void Attributes::apply(V* vertex) const {
+    if (label) {
+        vertex->label(*label);
+    }
+    if (font) {
+        vertex->font(*font);
+    }
+    if (shape) {
+        vertex->shape(*shape);
+    }
+    if (color) {
+        vertex->color(*color);
+    }
+    if (style) {
+        vertex->style(*style);
+    }
+}
+
+/// \Returns the enum value of type `E` that is written as \p text or nothing
+template <typename E>
+static std::optional<E> fromString(std::string_view text, E last) {
+    for (int i = 0; i <= static_cast<int>(last); ++i) {
+        if (toString(static_cast<E>(i)) == text) {
+            return static_cast<E>(i);
+        }
+    }
+    return std::nullopt;
+}
+
+/// \Returns the number `n` if \p name is `vertex_<n>`
+static std::optional<uintptr_t> generatedID(std::string_view name) {
+    constexpr std::string_view prefix = "vertex_";
+    if (!name.starts_with(prefix) || name.size() == prefix.size()) {
+        return std::nullopt;
+    }
+    uintptr_t value = 0;
+    auto* last = name.data() + name.size();
+    auto [ptr, ec] = std::from_chars(name.data() + prefix.size(), last, value);
+    if (ec != std::errc{} || ptr != last) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+/// \Returns the largest `n` of all occurrences of `vertex_<n>` in \p text or
+/// 0 if there are none. This includes occurrences that are not names, which
+/// only makes the result larger
+static uintptr_t largestGeneratedID(std::string_view text) {
+    constexpr std::string_view prefix = "vertex_";
+    uintptr_t result = 0;
+    auto* last = text.data() + text.size();
+    for (size_t pos = text.find(prefix); pos != std::string_view::npos;
+         pos = text.find(prefix, pos + prefix.size()))
+    {
+        uintptr_t value = 0;
+        auto* first = text.data() + pos + prefix.size();
+        if (std::from_chars(first, last, value).ec == std::errc{}) {
+            result = std::max(result, value);
+        }
+    }
+    return result;
+}
+
+bool Parser::isKeyword(std::string_view keyword) const {
+    if (tok.kind != TokenKind::Identifier ||
+        tok.text.size() != keyword.size())
+    {
+        return false;
+    }
+    return std::equal(keyword.begin(),
+                      keyword.end(),
+                      tok.text.begin(),
+                      [](char a, char b) { return a == (b | 0x20); });
+}
+
+Token Parser::expect(TokenKind kind, char const* what) {
+    if (tok.kind != kind) {
+        lexer.error(tok.pos, std::string("Expected ") + what);
+    }
+    Token result = tok;
+    advance();
+    return result;
+}
+
+std::unique_ptr<Graph> Parser::parse() {
+    advance();
+    if (isKeyword("strict")) {
+        advance();
+    }
+    GraphKind kind;
+    if (isKeyword("digraph")) {
+        kind = GraphKind::Directed;
+    }
+    else if (isKeyword("graph")) {
+        kind = GraphKind::Undirected;
+    }
+    else {
+        lexer.error(tok.pos, "Expected 'graph' or 'digraph'");
+    }
+    advance();
+    // The root graph keeps its ID only if it is named `vertex_<n>`, other
+    // names are ignored
+    std::optional<uintptr_t> id;
+    if (tok.kind == TokenKind::Identifier || tok.kind == TokenKind::String) {
+        id = generatedID(tok.text);
+        advance();
+    }
+    // Other vertices and graphs are numbered above all generated IDs, so IDs
+    // do not depend on the run and never collide with generated IDs
+    nextID = std::max(largestGeneratedID(input), id.value_or(0)) + 1;
+    auto graph = std::make_unique<Graph>(id.value_or(0));
+    root = graph.get();
+    graph->kind(kind);
+    expect(TokenKind::LBrace, "'{'");
+    parseBody();
+    expect(TokenKind::End, "end of input");
+    for (auto& [graph, id, name, defaults]: undeclared) {
+        if (root->find(id)) {
+            continue;
+        }
+        auto* vertex = graph->emplace<Vertex>(id);
+        vertex->label(makeLabel(name, LabelKind::PlainText));
+        defaults.apply(vertex);
+    }
+    return graph;
+}
+
+void Parser::parseBody() {
+    std::vector<Scope> scopes;
+    scopes.push_back({ root, {}, {} });
+    while (!scopes.empty()) {
+        if (tok.kind == TokenKind::End) {
+            lexer.error(tok.pos, "Expected '}'");
+        }
+        if (tok.kind != TokenKind::RBrace) {
+            parseStatement(scopes);
+            continue;
+        }
+        advance();
+        scopes.pop_back();
+        if (!scopes.empty() && tok.kind == TokenKind::EdgeOp) {
+            lexer.error(tok.pos, "Subgraphs as edge endpoints are not "
+                                 "supported");
+        }
+    }
+}
+
+void Parser::parseStatement(std::vector<Scope>& scopes) {
+    if (tok.kind == TokenKind::Semicolon) {
+        advance();
+        return;
+    }
+    if (tok.kind == TokenKind::LBrace || isKeyword("subgraph")) {
+        parseSubgraph(scopes);
+        return;
+    }
+    Scope& scope = scopes.back();
+    for (auto [keyword, target]: { std::pair{ "graph", 0 },
+                                   std::pair{ "node", 1 },
+                                   std::pair{ "edge", 2 } })
+    {
+        if (!isKeyword(keyword)) {
+            continue;
+        }
+        advance();
+        Attributes attributes;
+        parseAttributeLists(attributes);
+        switch (target) {
+        case 0:
+            setGraphAttributes(scope.graph, attributes);
+            break;
+        case 1:
+            scope.nodeDefaults.overlay(attributes);
+            break;
+        case 2:
+            scope.edgeDefaults.overlay(attributes);
+            break;
+        }
+        return;
+    }
+    if (tok.kind != TokenKind::Identifier && tok.kind != TokenKind::String &&
+        tok.kind != TokenKind::HTML)
+    {
+        lexer.error(tok.pos, "Expected a statement");
+    }
+    Token first = tok;
+    advance();
+    if (tok.kind == TokenKind::Equals) {
+        advance();
+        Token value = tok;
+        advance();
+        Attributes attributes;
+        setAttribute(attributes, first, value);
+        setGraphAttributes(scope.graph, attributes);
+        return;
+    }
+    skipPort();
+    if (tok.kind == TokenKind::EdgeOp) {
+        parseEdges(scope, first);
+    }
+    else {
+        parseNode(scope, first);
+    }
+}
+
+void Parser::parseSubgraph(std::vector<Scope>& scopes) {
+    Scope& scope = scopes.back();
+    std::optional<ID> id;
+    if (isKeyword("subgraph")) {
+        advance();
+        if (tok.kind == TokenKind::Identifier ||
+            tok.kind == TokenKind::String)
+        {
+            std::string_view name = unescape(tok);
+            if (name.starts_with("cluster_")) {
+                name.remove_prefix(8);
+            }
+            id = idFor(name);
+            advance();
+        }
+    }
+    expect(TokenKind::LBrace, "'{'");
+    Graph* graph = scope.graph->emplace<Graph>(id ? *id : makeID());
+    graph->kind(root->kind());
+    Scope nested{ graph, scope.nodeDefaults, scope.edgeDefaults };
+    scopes.push_back(std::move(nested));
+}
+
+void Parser::parseEdges(Scope& scope, Token first) {
+    std::vector<ID> chain;
+    auto addEndpoint = [&](Token const& token) {
+        std::string_view name = unescape(token);
+        ID id = idFor(name);
+        if (!root->find(id) && undeclaredIDs.insert(id, true).second) {
+            undeclared.push_back({ scope.graph, id, name, scope.nodeDefaults });
+        }
+        chain.push_back(id);
+    };
+    addEndpoint(first);
+    while (tok.kind == TokenKind::EdgeOp) {
+        advance();
+        if (tok.kind != TokenKind::Identifier &&
+            tok.kind != TokenKind::String)
+        {
+            lexer.error(tok.pos, "Expected a vertex name");
+        }
+        addEndpoint(tok);
+        advance();
+        skipPort();
+    }
+    Attributes attributes = scope.edgeDefaults;
+    parseAttributeLists(attributes);
+    for (size_t i = 1; i < chain.size(); ++i) {
+        scope.graph->add(
+            Edge{ chain[i - 1], chain[i], attributes.color, attributes.style });
+    }
+}
+
+void Parser::parseNode(Scope& scope, Token name) {
+    Attributes explicitAttributes;
+    parseAttributeLists(explicitAttributes);
+    ID id = idFor(unescape(name));
+    // Repeated declarations add attributes to the existing vertex
+    if (auto* vertex = root->find(id); vertex && !vertex->isGraph())
+    {
+        explicitAttributes.apply(vertex);
+        return;
+    }
+    Attributes attributes = scope.nodeDefaults;
+    attributes.overlay(explicitAttributes);
+    attributes.apply(scope.graph->emplace<Vertex>(id));
+}
+
+void Parser::skipPort() {
+    for (int i = 0; i < 2 && tok.kind == TokenKind::Colon; ++i) {
+        advance();
+        if (tok.kind != TokenKind::Identifier &&
+            tok.kind != TokenKind::String)
+        {
+            lexer.error(tok.pos, "Expected a port name");
+        }
+        advance();
+    }
+}
+
+void Parser::parseAttributeLists(Attributes& attributes) {
+    while (tok.kind == TokenKind::LBracket) {
+        advance();
+        while (tok.kind != TokenKind::RBracket) {
+            if (tok.kind != TokenKind::Identifier &&
+                tok.kind != TokenKind::String)
+            {
+                lexer.error(tok.pos, "Expected an attribute name");
+            }
+            Token key = tok;
+            advance();
+            if (tok.kind == TokenKind::Equals) {
+                advance();
+                Token value = tok;
+                if (value.kind != TokenKind::Identifier &&
+                    value.kind != TokenKind::String &&
+                    value.kind != TokenKind::HTML)
+                {
+                    lexer.error(tok.pos, "Expected an attribute value");
+                }
+                advance();
+                setAttribute(attributes, key, value);
+            }
+            if (tok.kind == TokenKind::Comma ||
+                tok.kind == TokenKind::Semicolon)
+            {
+                advance();
+            }
+        }
+        advance();
+    }
+}
+
+/// \Returns `true` if \p text contains escape sequences that are interpreted
+/// by graphviz, i.e. other than `\"`, `\\`, `\n` and line continuations
+static bool hasGraphvizEscapes(std::string_view text) {
+    for (size_t i = 0; i + 1 < text.size(); ++i) {
+        if (text[i] != '\\') {
+            continue;
+        }
+        switch (text[++i]) {
+        case '"':
+        case '\\':
+        case 'n':
+        case '\n':
+            break;
+        default:
+            return true;
+        }
+    }
+    return false;
+}
+
+void Parser::setAttribute(Attributes& attributes, Token key, Token value) {
+    std::string_view name = key.text;
+    if (name == "label") {
+        // Escapes like `\l` have no plain text equivalent, so such labels keep
+        // their escaped text and are written back unchanged
+        if (value.escaped && hasGraphvizEscapes(value.text)) {
+            attributes.label = makeLabel(value.text, LabelKind::Escaped);
+        }
+        else {
+            attributes.label =
+                makeLabel(unescape(value),
+                          value.kind == TokenKind::HTML ? LabelKind::HTML :
+                                                          LabelKind::PlainText);
+        }
+        return;
+    }
+    std::string_view text = unescape(value);
+    if (name == "fontname") {
+        attributes.font = text;
+    }
+    else if (name == "shape") {
+        if (auto shape = fromString(text, VertexShape::Point)) {
+            attributes.shape = shape;
+        }
+    }
+    else if (name == "color") {
+        if (auto color = fromString(text, Color::Purple)) {
+            attributes.color = color;
+        }
+    }
+    else if (name == "style") {
+        if (auto style = fromString(text, Style::Bold)) {
+            attributes.style = style;
+        }
+    }
+    else if (name == "rankdir") {
+        if (auto dir = fromString(text, RankDir::RightLeft)) {
+            attributes.rankdir = dir;
+        }
+    }
+}
+
+void Parser::setGraphAttributes(Graph* graph, Attributes const& attributes) {
+    attributes.apply(graph);
+    if (attributes.rankdir) {
+        graph->rankdir(*attributes.rankdir);
+    }
+}
+
+std::string_view Parser::unescape(Token const& token) {
+    if (!token.escaped) {
+        return token.text;
+    }
+    std::string text;
+    text.reserve(token.text.size());
+    for (size_t i = 0; i < token.text.size(); ++i) {
+        char c = token.text[i];
+        if (c != '\\' || i + 1 == token.text.size()) {
+            text.push_back(c);
+            continue;
+        }
+        char next = token.text[++i];
+        switch (next) {
+        case '"':
+        case '\\':
+            text.push_back(next);
+            break;
+        case 'n':
+            // Written for newlines in plain text labels
+            text.push_back('\n');
+            break;
+        case '\n':
+            // Line continuation
+            break;
+        default:
+            // Other escapes are interpreted by graphviz
+            text.push_back('\\');
+            text.push_back(next);
+            break;
+        }
+    }
+    return root->intern(text);
+}
+
+ID Parser::idFor(std::string_view name) {
+    if (auto id = generatedID(name)) {
+        return *id;
+    }
+    if (auto itr = names.find(name); itr != names.end()) {
+        return itr->second;
+    }
+    // The key must outlive the input of `parseDot()`
+    std::string_view copy = root->intern(name);
+    ID id = makeID();
+    names.insert({ copy, id });
+    return id;
+}
+
+struct DotDocument::Impl {
+    std::optional<MappedFile> file;
+    std::unordered_map<std::string_view, ID> names;
+    std::unique_ptr<Graph> graph;
+};
+
+DotDocument::DotDocument(std::unique_ptr<Impl> impl):
+    _impl(std::move(impl)), _graph(_impl->graph.get()) {}
+
+DotDocument::DotDocument(DotDocument&& rhs) noexcept = default;
+
+DotDocument& DotDocument::operator=(DotDocument&& rhs) noexcept = default;
+
+DotDocument::~DotDocument() = default;
+
+DotDocument DotDocument::load(std::filesystem::path const& path) {
+    auto impl = std::make_unique<Impl>();
+    impl->file.emplace(path);
+    impl->graph = Parser(impl->file->text(), false, impl->names).parse();
+    return DotDocument(std::move(impl));
+}
+
+DotDocument DotDocument::view(std::string_view text) {
+    auto impl = std::make_unique<Impl>();
+    impl->graph = Parser(text, false, impl->names).parse();
+    return DotDocument(std::move(impl));
+}
+
+std::optional<ID> DotDocument::id(std::string_view name) const {
+    if (auto id = generatedID(name)) {
+        return ID(*id);
+    }
+    if (auto itr = _impl->names.find(name); itr != _impl->names.end()) {
+        return itr->second;
+    }
+    return std::nullopt;
+}
+
+std::unique_ptr<Graph> graphgen::parseDot(std::string_view text) {
+    std::unordered_map<std::string_view, ID> names;
+    return Parser(text, true, names).parse();
+}
@@ -0,0 +1,458 @@
+#include "graphgen/reduce.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "edgekey.h"
+#include "graphgen/sink.h"
+#include "idmap.h"
+#include "traversal.h"
+
+using namespace graphgen;
+
+namespace {
+
+/// What the reductions removed around one vertex of the result
+struct Note {
+    size_t collapsedVertices = 0;
+    size_t collapsedGraphs = 0;
+    size_t collapsedEdges = 0;
+    size_t transitiveEdges = 0;
+    size_t fanOutEdges = 0;
+};
+
+/// Edge of the input together with the graph of the result it is added to
+struct FlatEdge {
+    ID from;
+    ID to;
+    std::optional<Color> color;
+    std::optional<Style> style;
+    Graph* owner;
+    bool removed = false;
+};
+
+/// Counts the vertices below every graph, including those of nested graphs.
+/// Sizes are indexed by the position of the graph in traversal order, because
+/// spilled graphs are read back into different objects on every traversal
+struct SizeCounter: TraversalCallbacks {
+    std::vector<size_t> sizes;
+    std::vector<size_t> stack;
+
+    bool enterGraph(Graph const&) {
+        stack.push_back(sizes.size());
+        sizes.push_back(0);
+        return true;
+    }
+
+    void leaveGraph(Graph const&) {
+        size_t size = sizes[stack.back()];
+        stack.pop_back();
+        if (!stack.empty()) {
+            sizes[stack.back()] += size;
+        }
+    }
+
+    void vertex(Vertex const&) { ++sizes[stack.back()]; }
+};
+
+/// Copies the tree of a graph and replaces the subgraphs that are too deep
+/// or too large by summary vertices. Edges are collected with their
+/// endpoints unchanged, because vertices inside collapsed graphs may appear
+/// after the edges that refer to them
+struct Copier: TraversalCallbacks {
+    ReduceOptions const& options;
+    std::vector<size_t> const& sizes;
+    size_t graphIndex = 0;
+    std::unique_ptr<Graph> result;
+    std::vector<Graph*> parents;
+    Graph const* collapsed = nullptr;
+    Vertex* summary = nullptr;
+    Note current;
+    IDMap<Vertex const*> remap;
+    IDMap<Note>& notes;
+    std::vector<FlatEdge>& edges;
+    ReduceStats& stats;
+
+    Copier(ReduceOptions const& options,
+           std::vector<size_t> const& sizes,
+           IDMap<Note>& notes,
+           std::vector<FlatEdge>& edges,
+           ReduceStats& stats):
+        options(options),
+        sizes(sizes),
+        notes(notes),
+        edges(edges),
+        stats(stats) {}
+
+    bool enterGraph(Graph const& graph);
+    void leaveGraph(Graph const& graph);
+    void vertex(Vertex const& vertex);
+
+    /// \p index is the position of the graph in traversal order
+    bool shouldCollapse(size_t index) const {
+        if (options.maxDepth && parents.size() > *options.maxDepth) {
+            return true;
+        }
+        return options.maxGraphSize && sizes[index] > *options.maxGraphSize;
+    }
+
+    Label copyLabel(Label const& label) {
+        if (label.isGenerated()) {
+            return label;
+        }
+        if (label.text().empty()) {
+            return Label(std::string_view{}, label.kind());
+        }
+        return Label::view(result->intern(label.text()), label.kind());
+    }
+
+    template <typename D>
+    void copyAttributes(D const& from, Vertex& to) {
+        to.label(copyLabel(from.label()))
+            ->shape(from.shape())
+            ->font(from.font())
+            ->color(from.color())
+            ->style(from.style());
+    }
+
+    void addEdges(Graph const& graph) {
+        for (Edge edge: graph.edges()) {
+            edges.push_back(
+                { edge.from, edge.to, edge.color, edge.style, parents.back() });
+        }
+    }
+};
+
+} // namespace
+
+bool Copier::enterGraph(Graph const& graph) {
+    size_t index = graphIndex++;
+    if (!result) {
+        result = std::make_unique<Graph>(graph.id());
+        copyAttributes(graph, *result);
+        result->kind(graph.kind())->rankdir(graph.rankdir());
+        parents.push_back(result.get());
+    }
+    else if (collapsed) {
+        remap.insert(graph.id(), summary);
+        ++current.collapsedGraphs;
+    }
+    else if (shouldCollapse(index)) {
+        collapsed = &graph;
+        current = {};
+        summary = parents.back()->emplace<Vertex>(graph.id());
+        copyAttributes(graph, *summary);
+    }
+    else {
+        auto* copy = parents.back()->emplace<Graph>(graph.id());
+        copyAttributes(graph, *copy);
+        copy->kind(graph.kind())->rankdir(graph.rankdir());
+        parents.push_back(copy);
+    }
+    addEdges(graph);
+    return true;
+}
+
+void Copier::leaveGraph(Graph const& graph) {
+    if (!collapsed) {
+        parents.pop_back();
+    }
+    else if (&graph == collapsed) {
+        collapsed = nullptr;
+        notes.insert(graph.id(), current);
+        ++stats.collapsedGraphs;
+        stats.collapsedVertices +=
+            current.collapsedVertices + current.collapsedGraphs;
+    }
+}
+
+void Copier::vertex(Vertex const& vertex) {
+    if (collapsed) {
+        remap.insert(vertex.id(), summary);
+        ++current.collapsedVertices;
+        return;
+    }
+    copyAttributes(vertex, *parents.back()->emplace<Vertex>(vertex.id()));
+}
+
+static Note& noteOf(IDMap<Note>& notes, ID id) {
+    return *notes.insert(id, {}).first;
+}
+
+/// Redirects edges into collapsed graphs to the summary vertices and removes
+/// the edges that become loops or duplicates
+static void redirectEdges(std::vector<FlatEdge>& edges,
+                          IDMap<Vertex const*> const& remap,
+                          IDMap<Note>& notes,
+                          ReduceStats& stats) {
+    if (remap.size() == 0) {
+        return;
+    }
+    std::unordered_set<EdgeKey> redirected;
+    for (auto& edge: edges) {
+        auto* from = remap.find(edge.from);
+        auto* to = remap.find(edge.to);
+        if (!from && !to) {
+            continue;
+        }
+        edge.from = from ? (*from)->id() : edge.from;
+        edge.to = to ? (*to)->id() : edge.to;
+        auto key = EdgeKey::of({ edge.from, edge.to, edge.color, edge.style });
+        if (edge.from == edge.to || !redirected.insert(key).second) {
+            edge.removed = true;
+            ++noteOf(notes, from ? edge.from : edge.to).collapsedEdges;
+            ++stats.collapsedEdges;
+        }
+    }
+}
+
+/// Removes edges without attributes that are implied by other paths. Edges
+/// with attributes are kept but may form the paths. The search for other
+/// paths from a vertex `u` starts at its successors and only follows vertices
+/// that come before the last successor of `u` in topological order, because
+/// no other vertex can lead to a successor
+static void reduceTransitively(std::vector<FlatEdge>& edges,
+                               size_t searchLimit,
+                               IDMap<Note>& notes,
+                               ReduceStats& stats) {
+    // Number the endpoints densely and build the adjacency lists
+    IDMap<uint32_t> indices;
+    std::vector<ID> ids;
+    auto indexOf = [&](ID id) {
+        auto [index, inserted] = indices.insert(id, uint32_t(ids.size()));
+        if (inserted) {
+            ids.push_back(id);
+        }
+        return *index;
+    };
+    std::vector<uint32_t> from, to;
+    std::vector<size_t> edgeIndices;
+    for (size_t i = 0; i < edges.size(); ++i) {
+        if (!edges[i].removed) {
+            from.push_back(indexOf(edges[i].from));
+            to.push_back(indexOf(edges[i].to));
+            edgeIndices.push_back(i);
+        }
+    }
+    size_t numVertices = ids.size();
+    std::vector<uint32_t> offsets(numVertices + 1);
+    std::vector<uint32_t> inDegree(numVertices);
+    for (size_t i = 0; i < from.size(); ++i) {
+        ++offsets[from[i] + 1];
+        ++inDegree[to[i]];
+    }
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    std::vector<uint32_t> successors(from.size());
+    std::vector<uint32_t> successorEdges(from.size());
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < from.size(); ++i) {
+            uint32_t slot = fill[from[i]]++;
+            successors[slot] = to[i];
+            successorEdges[slot] = uint32_t(i);
+        }
+    }
+    // Kahn's algorithm. Leftover vertices lie on a cycle
+    std::vector<uint32_t> order;
+    order.reserve(numVertices);
+    for (uint32_t v = 0; v < numVertices; ++v) {
+        if (inDegree[v] == 0) {
+            order.push_back(v);
+        }
+    }
+    for (size_t i = 0; i < order.size(); ++i) {
+        for (uint32_t s = offsets[order[i]]; s < offsets[order[i] + 1]; ++s) {
+            if (--inDegree[successors[s]] == 0) {
+                order.push_back(successors[s]);
+            }
+        }
+    }
+    if (order.size() != numVertices) {
+        stats.acyclic = false;
+        return;
+    }
+    std::vector<uint32_t> position(numVertices);
+    for (uint32_t i = 0; i < numVertices; ++i) {
+        position[order[i]] = i;
+    }
+    // Removing an edge with attributes would lose them, because the path that
+    // implies it does not show them
+    auto isPlain = [](FlatEdge const& edge) {
+        return !edge.color && !edge.style;
+    };
+    // Marks are stamped with the current vertex + 1, so they never need to be
+    // cleared
+    std::vector<uint32_t> direct(numVertices), visited(numVertices),
+        reached(numVertices);
+    std::vector<uint32_t> stack;
+    for (uint32_t u = 0; u < numVertices; ++u) {
+        uint32_t stamp = u + 1;
+        uint32_t begin = offsets[u], end = offsets[u + 1];
+        if (end - begin < 2) {
+            continue;
+        }
+        size_t removed = 0;
+        uint32_t last = 0;
+        stack.clear();
+        for (uint32_t s = begin; s < end; ++s) {
+            uint32_t w = successors[s];
+            auto& edge = edges[edgeIndices[successorEdges[s]]];
+            if (direct[w] == stamp) {
+                if (isPlain(edge)) {
+                    edge.removed = true;
+                    ++removed;
+                }
+                continue;
+            }
+            direct[w] = stamp;
+            visited[w] = stamp;
+            last = std::max(last, position[w]);
+            stack.push_back(w);
+        }
+        size_t budget = searchLimit;
+        while (!stack.empty() && budget > 0) {
+            uint32_t x = stack.back();
+            stack.pop_back();
+            for (uint32_t s = offsets[x]; s < offsets[x + 1] && budget > 0;
+                 ++s, --budget)
+            {
+                uint32_t y = successors[s];
+                if (position[y] > last) {
+                    continue;
+                }
+                reached[y] = stamp;
+                if (visited[y] != stamp) {
+                    visited[y] = stamp;
+                    stack.push_back(y);
+                }
+            }
+        }
+        for (uint32_t s = begin; s < end; ++s) {
+            auto& edge = edges[edgeIndices[successorEdges[s]]];
+            if (!edge.removed && isPlain(edge) &&
+                reached[successors[s]] == stamp)
+            {
+                edge.removed = true;
+                ++removed;
+            }
+        }
+        if (removed > 0) {
+            noteOf(notes, ids[u]).transitiveEdges += removed;
+            stats.transitiveEdges += removed;
+        }
+    }
+}
+
+/// Drops the edges of each vertex beyond the first \p maxFanOut
+static void limitFanOut(std::vector<FlatEdge>& edges,
+                        size_t maxFanOut,
+                        IDMap<Note>& notes,
+                        ReduceStats& stats) {
+    IDMap<size_t> fanOut;
+    for (auto& edge: edges) {
+        if (edge.removed) {
+            continue;
+        }
+        size_t& count = *fanOut.insert(edge.from, 0).first;
+        if (count == maxFanOut) {
+            edge.removed = true;
+            ++noteOf(notes, edge.from).fanOutEdges;
+            ++stats.fanOutEdges;
+            continue;
+        }
+        ++count;
+    }
+}
+
+static std::string describe(Note const& note) {
+    std::vector<std::string> parts;
+    if (note.collapsedVertices + note.collapsedGraphs + note.collapsedEdges >
+        0)
+    {
+        std::string part = "[collapsed";
+        char const* separator = " ";
+        auto add = [&](size_t count, char const* what) {
+            if (count > 0) {
+                part += separator + std::to_string(count) + what;
+                separator = ", ";
+            }
+        };
+        add(note.collapsedVertices, " vertices");
+        add(note.collapsedGraphs, " subgraphs");
+        add(note.collapsedEdges, " edges");
+        parts.push_back(part + "]");
+    }
+    if (note.transitiveEdges > 0) {
+        parts.push_back("[removed " + std::to_string(note.transitiveEdges) +
+                        " implied edges]");
+    }
+    if (note.fanOutEdges > 0) {
+        parts.push_back("[omitted " + std::to_string(note.fanOutEdges) +
+                        " edges]");
+    }
+    std::string text;
+    for (auto& part: parts) {
+        text += text.empty() ? "" : " ";
+        text += part;
+    }
+    return text;
+}
+
+/// \Returns \p label with \p note appended on a new line. Generated labels
+/// stay generated
+static Label annotate(Label const& label, std::string note) {
+    char const* separator = label.kind() == LabelKind::HTML    ? "<br/>" :
+                            label.kind() == LabelKind::Escaped ? "\\n" :
+                                                                 "\n";
+    if (label.isGenerated()) {
+        return Label(
+            [label, separator, note = std::move(note)](std::ostream& str) {
+            BufferSink text;
+            label.writeText(text);
+            str << text.view() << separator << note;
+        },
+            label.kind());
+    }
+    if (label.text().empty()) {
+        return Label(note, label.kind());
+    }
+    return Label(std::string(label.text()) + separator + note, label.kind());
+}
+
+std::unique_ptr<Graph> graphgen::reduce(Graph const& graph,
+                                        ReduceOptions const& options) {
+    ReduceStats localStats;
+    ReduceStats& stats = options.stats ? *options.stats : localStats;
+    stats = {};
+    SizeCounter counter;
+    if (options.maxGraphSize) {
+        traverse(graph, counter);
+    }
+    IDMap<Note> notes;
+    std::vector<FlatEdge> edges;
+    Copier copier(options, counter.sizes, notes, edges, stats);
+    traverse(graph, copier);
+    redirectEdges(edges, copier.remap, notes, stats);
+    auto& result = *copier.result;
+    if (options.transitiveReduction && result.kind() == GraphKind::Directed) {
+        reduceTransitively(edges, options.transitiveSearchLimit, notes, stats);
+    }
+    if (options.maxFanOut) {
+        limitFanOut(edges, *options.maxFanOut, notes, stats);
+    }
+    for (auto& edge: edges) {
+        if (!edge.removed) {
+            edge.owner->add(Edge{ edge.from, edge.to, edge.color, edge.style });
+        }
+    }
+    notes.forEach([&](ID id, Note const& note) {
+        if (auto* vertex = result.find(id)) {
+            vertex->label(annotate(vertex->label(), describe(note)));
+        }
+    });
+    return std::move(copier.result);
+}
@@ -0,0 +1,382 @@
+#include "graphgen/sink.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <ostream>
+#include <streambuf>
+#include <system_error>
+#include <thread>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "util.h"
+
+using namespace graphgen;
+
+/// Unbuffered stream buffer that forwards everything to the sink, so output
+/// of user callbacks is interleaved correctly with the output of the generator
+struct Sink::StreamAdapter: std::streambuf {
+    explicit StreamAdapter(Sink& sink): sink(sink), stream(this) {}
+
+    int_type overflow(int_type ch) override {
+        if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+            sink.put(traits_type::to_char_type(ch));
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    std::streamsize xsputn(char const* data, std::streamsize size) override {
+        sink.write({ data, static_cast<std::size_t>(size) });
+        return size;
+    }
+
+    Sink& sink;
+    std::ostream stream;
+};
+
+Sink::Sink() = default;
+
+Sink::~Sink() = default;
+
+std::ostream& Sink::ostream() {
+    if (!_stream) {
+        _stream = std::make_unique<StreamAdapter>(*this);
+    }
+    return _stream->stream;
+}
+
+void Sink::writeSlow(std::string_view text) {
+    while (!text.empty()) {
+        if (_current == _end) {
+            overflow(1);
+        }
+        std::size_t size = std::min(text.size(), available());
+        std::memcpy(_current, text.data(), size);
+        _current += size;
+        text.remove_prefix(size);
+    }
+}
+
+BufferSink::BufferSink(std::size_t initialCapacity):
+    _buffer(std::max<std::size_t>(initialCapacity, 256)) {
+    setBuffer(_buffer.data(), _buffer.data(), _buffer.data() + _buffer.size());
+}
+
+void BufferSink::clear() {
+    setBuffer(_buffer.data(), _buffer.data(), _buffer.data() + _buffer.size());
+}
+
+void BufferSink::overflow(std::size_t size) {
+    std::size_t used = this->size();
+    std::size_t newSize = std::max(_buffer.size() * 2, used + size);
+    _buffer.resize(newSize);
+    setBuffer(_buffer.data(),
+              _buffer.data() + used,
+              _buffer.data() + _buffer.size());
+}
+
+static void writeAll(int fd, char const* data, std::size_t size) {
+    while (size > 0) {
+#if defined(_WIN32)
+        auto result = ::_write(fd, data, static_cast<unsigned>(size));
+#else
+        auto result = ::write(fd, data, size);
+#endif
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno,
+                                    std::generic_category(),
+                                    "Failed to write graph output");
+        }
+        data += result;
+        size -= static_cast<std::size_t>(result);
+    }
+}
+
+static int openForWriting(std::filesystem::path const& path) {
+#if defined(_WIN32)
+    int fd = ::_wopen(path.c_str(),
+                      _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY,
+                      _S_IREAD | _S_IWRITE);
+#else
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+    if (fd < 0) {
+        throw std::system_error(errno,
+                                std::generic_category(),
+                                "Failed to open " + path.string());
+    }
+    return fd;
+}
+
+static void closeFD(int fd) {
+#if defined(_WIN32)
+    ::_close(fd);
+#else
+    ::close(fd);
+#endif
+}
+
+FileSink::FileSink(int fd, std::size_t blockSize):
+    _buffer(std::max<std::size_t>(blockSize, 256)), _fd(fd), _ownsFD(false) {
+    setBuffer(_buffer.data(), _buffer.data(), _buffer.data() + _buffer.size());
+}
+
+FileSink::FileSink(std::filesystem::path const& path, std::size_t blockSize):
+    FileSink(openForWriting(path), blockSize) {
+    _ownsFD = true;
+}
+
+FileSink::~FileSink() {
+    try {
+        flush();
+    }
+    catch (std::system_error const&) {
+        // Destructors must not throw. Call flush() explicitly to observe
+        // errors
+    }
+    if (_ownsFD) {
+        closeFD(_fd);
+    }
+}
+
+void FileSink::flush() {
+    std::size_t size = static_cast<std::size_t>(bufferCurrent() - bufferBegin());
+    writeAll(_fd, _buffer.data(), size);
+    noteFlushed(size);
+    setBuffer(_buffer.data(), _buffer.data(), _buffer.data() + _buffer.size());
+}
+
+void FileSink::open(std::filesystem::path const& path) {
+    flush();
+    if (_ownsFD) {
+        closeFD(_fd);
+        _ownsFD = false;
+    }
+    _fd = -1;
+    _fd = openForWriting(path);
+    _ownsFD = true;
+}
+
+void FileSink::overflow(std::size_t size) {
+    flush();
+    if (_buffer.size() < size) {
+        _buffer.resize(size);
+        setBuffer(_buffer.data(),
+                  _buffer.data(),
+                  _buffer.data() + _buffer.size());
+    }
+}
+
+/// Blocks are either owned by the generator, queued for writing, being
+/// written or free. The generator only touches the block it owns, so the
+/// mutex guards the queue and the free list only
+struct AsyncFileSink::Pipeline {
+    struct Chunk {
+        std::vector<char>* block;
+        std::size_t size;
+    };
+
+    Pipeline(int fd, std::size_t blockSize, std::size_t numBlocks):
+        fd(fd), blocks(std::max<std::size_t>(numBlocks, 2)) {
+        for (auto& block: blocks) {
+            block.resize(std::max<std::size_t>(blockSize, 256));
+            freeBlocks.push_back(&block);
+        }
+        writer = std::thread([this] { run(); });
+    }
+
+    ~Pipeline() {
+        {
+            std::lock_guard lock(mutex);
+            stop = true;
+        }
+        changed.notify_all();
+        writer.join();
+    }
+
+    void run() {
+        std::unique_lock lock(mutex);
+        while (true) {
+            changed.wait(lock, [&] { return stop || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            Chunk chunk = queue.front();
+            queue.pop_front();
+            // After an error the remaining chunks are dropped, so the
+            // generator does not wait forever
+            if (!error) {
+                lock.unlock();
+                std::exception_ptr failure;
+                try {
+                    writeAll(fd, chunk.block->data(), chunk.size);
+                }
+                catch (std::system_error const&) {
+                    failure = std::current_exception();
+                }
+                lock.lock();
+                if (failure) {
+                    error = failure;
+                }
+            }
+            freeBlocks.push_back(chunk.block);
+            changed.notify_all();
+        }
+    }
+
+    /// Queues the first \p size bytes of \p block for writing
+    void submit(std::vector<char>* block, std::size_t size) {
+        {
+            std::lock_guard lock(mutex);
+            queue.push_back({ block, size });
+        }
+        changed.notify_all();
+    }
+
+    /// Waits for a free block. Throws if a write has failed
+    std::vector<char>* acquire() {
+        std::unique_lock lock(mutex);
+        changed.wait(lock, [&] { return error || !freeBlocks.empty(); });
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        auto* block = freeBlocks.back();
+        freeBlocks.pop_back();
+        return block;
+    }
+
+    /// Waits until all queued chunks are written. Throws if a write has failed
+    void drain(std::size_t numOwned) {
+        std::unique_lock lock(mutex);
+        changed.wait(lock, [&] {
+            return freeBlocks.size() + numOwned == blocks.size();
+        });
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    int fd;
+    std::deque<std::vector<char>> blocks;
+    std::vector<std::vector<char>*> freeBlocks;
+    std::deque<Chunk> queue;
+    std::exception_ptr error;
+    bool stop = false;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::thread writer;
+};
+
+AsyncFileSink::AsyncFileSink(int fd,
+                             std::size_t blockSize,
+                             std::size_t numBlocks):
+    _pipeline(std::make_unique<Pipeline>(fd, blockSize, numBlocks)),
+    _fd(fd),
+    _ownsFD(false) {
+    acquireBlock();
+}
+
+AsyncFileSink::AsyncFileSink(std::filesystem::path const& path,
+                             std::size_t blockSize,
+                             std::size_t numBlocks):
+    _fd(openForWriting(path)), _ownsFD(true) {
+    // The destructor does not run if starting the pipeline fails, so the file
+    // is closed here until the sink is fully constructed
+    bool constructed = false;
+    ScopeGuard closeOnError([&]() noexcept {
+        if (!constructed) {
+            closeFD(_fd);
+        }
+    });
+    _pipeline = std::make_unique<Pipeline>(_fd, blockSize, numBlocks);
+    acquireBlock();
+    constructed = true;
+}
+
+AsyncFileSink::~AsyncFileSink() {
+    try {
+        flush();
+    }
+    catch (std::system_error const&) {
+        // Destructors must not throw. Call flush() explicitly to observe
+        // errors
+    }
+    _pipeline.reset();
+    if (_ownsFD) {
+        closeFD(_fd);
+    }
+}
+
+void AsyncFileSink::flush() {
+    std::size_t size = static_cast<std::size_t>(bufferCurrent() - bufferBegin());
+    if (size > 0) {
+        _pipeline->submit(_block, size);
+        noteFlushed(size);
+        _block = nullptr;
+        setBuffer(nullptr, nullptr, nullptr);
+    }
+    _pipeline->drain(_block ? 1 : 0);
+    if (!_block) {
+        acquireBlock();
+    }
+}
+
+void AsyncFileSink::overflow(
+    [[maybe_unused]] std::size_t size) {
+    std::size_t used = static_cast<std::size_t>(bufferCurrent() - bufferBegin());
+    if (used > 0) {
+        _pipeline->submit(_block, used);
+        noteFlushed(used);
+        _block = nullptr;
+        setBuffer(nullptr, nullptr, nullptr);
+    }
+    if (!_block) {
+        acquireBlock();
+    }
+    // Blocks never grow, so memory stays bounded. `Sink::write()` splits long
+    // text over multiple blocks, and other requests are a few bytes
+    assert(size <= _block->size());
+}
+
+void AsyncFileSink::acquireBlock() {
+    _block = _pipeline->acquire();
+    setBuffer(_block->data(), _block->data(), _block->data() + _block->size());
+}
+
+OStreamSink::OStreamSink(std::ostream& ostream, std::size_t blockSize):
+    _buffer(std::max<std::size_t>(blockSize, 256)), _ostream(ostream) {
+    setBuffer(_buffer.data(), _buffer.data(), _buffer.data() + _buffer.size());
+}
+
+OStreamSink::~OStreamSink() { flush(); }
+
+void OStreamSink::flush() {
+    std::size_t size = static_cast<std::size_t>(bufferCurrent() - bufferBegin());
+    _ostream.write(_buffer.data(), static_cast<std::streamsize>(size));
+    noteFlushed(size);
+    setBuffer(_buffer.data(), _buffer.data(), _buffer.data() + _buffer.size());
+}
+
+void OStreamSink::overflow(std::size_t size) {
+    flush();
+    if (_buffer.size() < size) {
+        _buffer.resize(size);
+        setBuffer(_buffer.data(),
+                  _buffer.data(),
+                  _buffer.data() + _buffer.size());
+    }
+}
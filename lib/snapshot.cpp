@@ -0,0 +1,597 @@
+#include "graphgen/snapshot.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "dotwriter.h"
+#include "edgekey.h"
+#include "graphgen/generate.h"
+#include "graphgen/sink.h"
+#include "idmap.h"
+#include "mappedfile.h"
+#include "traversal.h"
+
+using namespace graphgen;
+
+/// The file starts with the header, followed by the vertex records in
+/// pre-order, the edge records grouped by graph and finally the string table.
+/// All integers are stored in native byte order, the endian marker is used to
+/// reject snapshots written on machines with a different byte order
+struct Snapshot::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;
+    uint64_t numNodes;
+    uint64_t numEdges;
+    uint64_t stringsSize;
+    uint64_t nodesOffset;
+    uint64_t edgesOffset;
+    uint64_t stringsOffset;
+};
+
+static_assert(sizeof(Snapshot::Header) == 64);
+
+namespace {
+
+enum NodeFlags : uint8_t {
+    IsGraph = 1 << 0,
+    HasFont = 1 << 1,
+};
+
+} // namespace
+
+/// Fixed size record of a vertex or graph. `subtreeSize` is the number of
+/// records of all descendants, so the next sibling of the record at index `i`
+/// is at `i + 1 + subtreeSize`. Optional enums are stored as value + 1 with 0
+/// meaning unset
+struct Snapshot::NodeRecord {
+    uint64_t id;
+    uint64_t subtreeSize;
+    uint64_t firstEdge;
+    uint64_t numEdges;
+    uint64_t labelOffset;
+    uint64_t fontOffset;
+    uint32_t labelSize;
+    uint32_t fontSize;
+    uint8_t flags;
+    uint8_t labelKind;
+    uint8_t shape;
+    uint8_t color;
+    uint8_t style;
+    uint8_t graphKind;
+    uint8_t rankDir;
+    uint8_t padding;
+};
+
+static_assert(sizeof(Snapshot::NodeRecord) == 64);
+
+struct Snapshot::EdgeRecord {
+    uint64_t from;
+    uint64_t to;
+    uint8_t color;
+    uint8_t style;
+    uint8_t padding[6];
+};
+
+static_assert(sizeof(Snapshot::EdgeRecord) == 24);
+
+static constexpr char Magic[8] = { 'G', 'R', 'A', 'P', 'H', 'G', 'E', 'N' };
+
+static constexpr uint32_t EndianMarker = 0x01020304;
+
+template <typename E>
+static uint8_t encode(std::optional<E> value) {
+    return value ? static_cast<uint8_t>(static_cast<int>(*value) + 1) : 0;
+}
+
+template <typename E>
+static std::optional<E> decode(uint8_t value) {
+    return value ? std::optional(static_cast<E>(value - 1)) : std::nullopt;
+}
+
+namespace {
+
+struct SnapshotBuilder: TraversalCallbacks {
+    std::vector<Snapshot::NodeRecord> nodes;
+    std::vector<Snapshot::EdgeRecord> edges;
+    BufferSink strings;
+    std::unordered_map<std::string_view, uint64_t> fontOffsets;
+
+    /// Record indices of the graphs on the path from the root
+    std::vector<size_t> openGraphs;
+
+    bool enterGraph(Graph const& graph);
+    void leaveGraph(Graph const& graph);
+    void vertex(Vertex const& vertex);
+    void addCommon(Vertex const& vertex, Snapshot::NodeRecord& record);
+};
+
+} // namespace
+
+void SnapshotBuilder::addCommon(Vertex const& vertex,
+                                Snapshot::NodeRecord& record) {
+    record.id = vertex.id().raw();
+    record.labelOffset = strings.size();
+    vertex.label().writeText(strings);
+    record.labelSize =
+        static_cast<uint32_t>(strings.size() - record.labelOffset);
+    record.labelKind = static_cast<uint8_t>(vertex.label().kind());
+    if (auto font = vertex.font()) {
+        auto [itr, inserted] = fontOffsets.insert({ *font, strings.size() });
+        if (inserted) {
+            strings.write(*font);
+        }
+        record.flags |= HasFont;
+        record.fontOffset = itr->second;
+        record.fontSize = static_cast<uint32_t>(font->size());
+    }
+    record.shape = static_cast<uint8_t>(vertex.shape());
+    record.color = encode(vertex.color());
+    record.style = encode(vertex.style());
+}
+
+bool SnapshotBuilder::enterGraph(Graph const& graph) {
+    size_t index = nodes.size();
+    nodes.push_back({});
+    auto& record = nodes[index];
+    addCommon(graph, record);
+    record.flags |= IsGraph;
+    record.graphKind = static_cast<uint8_t>(graph.kind());
+    record.rankDir = static_cast<uint8_t>(graph.rankdir());
+    record.firstEdge = edges.size();
+    record.numEdges = graph.edges().size();
+    for (Edge edge: graph.edges()) {
+        edges.push_back({ .from = edge.from.raw(),
+                          .to = edge.to.raw(),
+                          .color = encode(edge.color),
+                          .style = encode(edge.style),
+                          .padding = {} });
+    }
+    openGraphs.push_back(index);
+    return true;
+}
+
+void SnapshotBuilder::leaveGraph(Graph const&) {
+    size_t index = openGraphs.back();
+    openGraphs.pop_back();
+    nodes[index].subtreeSize = nodes.size() - index - 1;
+}
+
+void SnapshotBuilder::vertex(Vertex const& vertex) {
+    nodes.push_back({});
+    addCommon(vertex, nodes.back());
+}
+
+template <typename T>
+static void writeRecords(Sink& sink, std::vector<T> const& records) {
+    sink.write({ reinterpret_cast<char const*>(records.data()),
+                 records.size() * sizeof(T) });
+}
+
+void graphgen::saveSnapshot(Graph const& graph, Sink& sink) {
+    SnapshotBuilder builder;
+    traverse(graph, builder);
+    Snapshot::Header header{};
+    std::memcpy(header.magic, Magic, sizeof Magic);
+    header.version = SnapshotVersion;
+    header.endian = EndianMarker;
+    header.numNodes = builder.nodes.size();
+    header.numEdges = builder.edges.size();
+    header.stringsSize = builder.strings.size();
+    header.nodesOffset = sizeof(Snapshot::Header);
+    header.edgesOffset =
+        header.nodesOffset + header.numNodes * sizeof(Snapshot::NodeRecord);
+    header.stringsOffset =
+        header.edgesOffset + header.numEdges * sizeof(Snapshot::EdgeRecord);
+    sink.write({ reinterpret_cast<char const*>(&header), sizeof header });
+    writeRecords(sink, builder.nodes);
+    writeRecords(sink, builder.edges);
+    sink.write(builder.strings.view());
+    sink.flush();
+}
+
+void graphgen::saveSnapshot(Graph const& graph,
+                            std::filesystem::path const& path) {
+    FileSink sink(path);
+    saveSnapshot(graph, sink);
+}
+
+/// Owns the memory of a loaded snapshot
+struct Snapshot::Mapping {
+    explicit Mapping(std::filesystem::path const& path): file(path) {}
+
+    MappedFile file;
+};
+
+Snapshot::Snapshot(std::unique_ptr<Mapping> mapping,
+                   char const* data,
+                   size_t size):
+    _mapping(std::move(mapping)), _data(data), _size(size) {
+    validate();
+}
+
+Snapshot::Snapshot(Snapshot&& rhs) noexcept = default;
+
+Snapshot& Snapshot::operator=(Snapshot&& rhs) noexcept = default;
+
+Snapshot::~Snapshot() = default;
+
+Snapshot Snapshot::load(std::filesystem::path const& path) {
+    auto mapping = std::make_unique<Mapping>(path);
+    char const* data = mapping->file.data();
+    size_t size = mapping->file.size();
+    return Snapshot(std::move(mapping), data, size);
+}
+
+Snapshot Snapshot::view(std::span<char const> data) {
+    return Snapshot(nullptr, data.data(), data.size());
+}
+
+static bool inBounds(uint64_t offset, uint64_t size, uint64_t total) {
+    return offset <= total && size <= total - offset;
+}
+
+/// \Returns `true` if an array of \p count elements of \p elementSize bytes
+/// at \p offset lies in the first \p total bytes. Checks for overflow
+static bool arrayInBounds(uint64_t offset,
+                          uint64_t count,
+                          uint64_t elementSize,
+                          uint64_t total) {
+    return offset <= total && count <= (total - offset) / elementSize;
+}
+
+/// \Returns `true` if \p raw is the value of an enumerator of `E` up to
+/// \p last
+template <typename E>
+static bool isEnum(uint8_t raw, E last) {
+    return raw <= static_cast<uint8_t>(last);
+}
+
+/// \Returns `true` if \p raw is an optional enum encoded with `encode()`
+template <typename E>
+static bool isOptionalEnum(uint8_t raw, E last) {
+    return raw <= static_cast<uint8_t>(last) + 1;
+}
+
+void Snapshot::validate() const {
+    auto fail = [](char const* reason) {
+        throw std::runtime_error(std::string("Invalid snapshot: ") + reason);
+    };
+    if (_size < sizeof(Header) || reinterpret_cast<uintptr_t>(_data) % 8 != 0)
+    {
+        fail("truncated or misaligned header");
+    }
+    auto const& h = header();
+    if (std::memcmp(h.magic, Magic, sizeof Magic) != 0) {
+        fail("bad magic number");
+    }
+    if (h.endian != EndianMarker) {
+        fail("byte order mismatch");
+    }
+    if (h.version != SnapshotVersion) {
+        fail("unsupported version");
+    }
+    if (h.numNodes == 0 || h.nodesOffset % 8 != 0 || h.edgesOffset % 8 != 0 ||
+        !arrayInBounds(h.nodesOffset, h.numNodes, sizeof(NodeRecord), _size) ||
+        !arrayInBounds(h.edgesOffset, h.numEdges, sizeof(EdgeRecord), _size) ||
+        !inBounds(h.stringsOffset, h.stringsSize, _size))
+    {
+        fail("section out of bounds");
+    }
+    if (!(node(0).flags & IsGraph) || node(0).subtreeSize != h.numNodes - 1) {
+        fail("root is not a graph spanning all records");
+    }
+    // Every record must lie within the subtree of the graph it is in. The
+    // stack holds the end indices of the subtrees of the open graphs
+    std::vector<uint64_t> ends;
+    for (uint64_t i = 0; i < h.numNodes; ++i) {
+        while (!ends.empty() && ends.back() == i) {
+            ends.pop_back();
+        }
+        auto const& record = node(i);
+        uint64_t limit = ends.empty() ? h.numNodes : ends.back();
+        if (record.subtreeSize > limit - i - 1) {
+            fail("subtree out of bounds");
+        }
+        if (!inBounds(record.labelOffset, record.labelSize, h.stringsSize) ||
+            ((record.flags & HasFont) &&
+             !inBounds(record.fontOffset, record.fontSize, h.stringsSize)))
+        {
+            fail("string out of bounds");
+        }
+        if (!isEnum(record.labelKind, LabelKind::Escaped) ||
+            !isEnum(record.shape, VertexShape::Point) ||
+            !isOptionalEnum(record.color, Color::Purple) ||
+            !isOptionalEnum(record.style, Style::Bold))
+        {
+            fail("invalid attribute");
+        }
+        if (!(record.flags & IsGraph)) {
+            if (record.subtreeSize != 0) {
+                fail("vertex with children");
+            }
+            continue;
+        }
+        if (!inBounds(record.firstEdge, record.numEdges, h.numEdges)) {
+            fail("edges out of bounds");
+        }
+        // Trees are not supported by the generator
+        if (!isEnum(record.graphKind, GraphKind::Undirected) ||
+            !isEnum(record.rankDir, RankDir::RightLeft))
+        {
+            fail("invalid attribute");
+        }
+        ends.push_back(i + 1 + record.subtreeSize);
+    }
+    for (uint64_t i = 0; i < h.numEdges; ++i) {
+        auto const& record = edge(i);
+        if (!isOptionalEnum(record.color, Color::Purple) ||
+            !isOptionalEnum(record.style, Style::Bold))
+        {
+            fail("invalid edge attribute");
+        }
+    }
+}
+
+Snapshot::Header const& Snapshot::header() const {
+    return *reinterpret_cast<Header const*>(_data);
+}
+
+Snapshot::NodeRecord const& Snapshot::node(size_t index) const {
+    return reinterpret_cast<NodeRecord const*>(_data +
+                                               header().nodesOffset)[index];
+}
+
+Snapshot::EdgeRecord const& Snapshot::edge(size_t index) const {
+    return reinterpret_cast<EdgeRecord const*>(_data +
+                                               header().edgesOffset)[index];
+}
+
+std::string_view Snapshot::string(uint64_t offset, uint32_t size) const {
+    return { _data + header().stringsOffset + offset, size };
+}
+
+size_t Snapshot::numVertices() const { return header().numNodes; }
+
+size_t Snapshot::numEdges() const { return header().numEdges; }
+
+ID SnapshotVertex::id() const { return _snapshot->node(_index).id; }
+
+Label SnapshotVertex::label() const {
+    auto const& record = _snapshot->node(_index);
+    return Label::view(_snapshot->string(record.labelOffset, record.labelSize),
+                       static_cast<LabelKind>(record.labelKind));
+}
+
+std::optional<std::string_view> SnapshotVertex::font() const {
+    auto const& record = _snapshot->node(_index);
+    if (!(record.flags & HasFont)) {
+        return std::nullopt;
+    }
+    return _snapshot->string(record.fontOffset, record.fontSize);
+}
+
+VertexShape SnapshotVertex::shape() const {
+    return static_cast<VertexShape>(_snapshot->node(_index).shape);
+}
+
+std::optional<Color> SnapshotVertex::color() const {
+    return decode<Color>(_snapshot->node(_index).color);
+}
+
+std::optional<Style> SnapshotVertex::style() const {
+    return decode<Style>(_snapshot->node(_index).style);
+}
+
+bool SnapshotVertex::isGraph() const {
+    return _snapshot->node(_index).flags & IsGraph;
+}
+
+SnapshotGraph SnapshotVertex::asGraph() const {
+    return SnapshotGraph(_snapshot, _index);
+}
+
+SnapshotGraph::Iterator& SnapshotGraph::Iterator::operator++() {
+    index += 1 + snapshot->node(index).subtreeSize;
+    return *this;
+}
+
+Edge SnapshotGraph::EdgeIterator::operator*() const {
+    auto const& record = snapshot->edge(index);
+    return { record.from,
+             record.to,
+             decode<Color>(record.color),
+             decode<Style>(record.style) };
+}
+
+GraphKind SnapshotGraph::kind() const {
+    return static_cast<GraphKind>(_snapshot->node(_index).graphKind);
+}
+
+RankDir SnapshotGraph::rankdir() const {
+    return static_cast<RankDir>(_snapshot->node(_index).rankDir);
+}
+
+SnapshotGraph::VertexRange SnapshotGraph::vertices() const {
+    size_t end = _index + 1 + _snapshot->node(_index).subtreeSize;
+    return { Iterator(_snapshot, _index + 1), Iterator(_snapshot, end) };
+}
+
+SnapshotGraph::EdgeRange SnapshotGraph::edges() const {
+    auto const& record = _snapshot->node(_index);
+    return { EdgeIterator(_snapshot, record.firstEdge),
+             EdgeIterator(_snapshot, record.firstEdge + record.numEdges) };
+}
+
+/// Walks the records below \p root in pre-order and invokes the callbacks of
+/// \p callbacks like `traverse()` does for graph trees. Open graphs are kept in
+/// an explicit stack, so arbitrarily deep nesting does not overflow the call
+/// stack
+template <typename C>
+static void walk(SnapshotGraph root, C& callbacks) {
+    struct Frame {
+        SnapshotGraph graph;
+        SnapshotGraph::Iterator next, end;
+    };
+    auto makeFrame = [](SnapshotGraph graph) {
+        auto vertices = graph.vertices();
+        return Frame{ graph, vertices.begin(), vertices.end() };
+    };
+    callbacks.enterGraph(root);
+    std::vector<Frame> stack = { makeFrame(root) };
+    while (!stack.empty()) {
+        auto& top = stack.back();
+        if (top.next == top.end) {
+            SnapshotGraph graph = top.graph;
+            stack.pop_back();
+            callbacks.leaveGraph(graph, stack.size());
+            continue;
+        }
+        SnapshotVertex vertex = *top.next;
+        ++top.next;
+        if (vertex.isGraph()) {
+            callbacks.enterGraph(vertex.asGraph());
+            stack.push_back(makeFrame(vertex.asGraph()));
+            continue;
+        }
+        callbacks.vertex(vertex);
+    }
+}
+
+namespace {
+
+/// Names vertices in the same order as compact names of graph trees
+struct SnapshotNamer {
+    IDMap<size_t>& names;
+    std::vector<ID> order;
+
+    void name(ID id) {
+        if (names.insert(id, order.size()).second) {
+            order.push_back(id);
+        }
+    }
+
+    void enterGraph(SnapshotGraph graph) {
+        if (!graph.isRoot()) {
+            name(graph.id());
+        }
+    }
+
+    void leaveGraph(SnapshotGraph graph, size_t /* depth */) {
+        for (Edge edge: graph.edges()) {
+            name(edge.from);
+            name(edge.to);
+        }
+    }
+
+    void vertex(SnapshotVertex vertex) { name(vertex.id()); }
+};
+
+struct SnapshotGenerator {
+    DotWriter& writer;
+    GenerateOptions const& options;
+    GenerateStats* stats;
+    EdgeCoalescer coalescer;
+    std::chrono::steady_clock::time_point topLevelStart;
+
+    void enterGraph(SnapshotGraph graph) {
+        if (stats && writer.depth() == 1) {
+            stats->subgraphTimes.push_back({ graph.id(), {} });
+            topLevelStart = std::chrono::steady_clock::now();
+        }
+        if (stats && !graph.isRoot()) {
+            ++stats->subgraphs;
+            stats->maxDepth = std::max(stats->maxDepth, writer.depth());
+        }
+        writer.beginScope(ScopeKind::Brace, graph.id(), graph.isRoot(),
+                          graph.font());
+        writer.commonDecls(graph);
+        writer.line("rankdir = ", graph.rankdir());
+    }
+
+    void leaveGraph(SnapshotGraph graph, size_t depth) {
+        if (options.coalesceEdges == EdgeCoalescing::None) {
+            size_t count = 0;
+            for (Edge edge: graph.edges()) {
+                writer.edge(edge);
+                ++count;
+            }
+            if (stats) {
+                stats->edges += count;
+            }
+        }
+        else {
+            auto coalesced = coalescer.run(
+                graph.edges(), writer.graphKind == GraphKind::Undirected);
+            for (auto& [edge, count]: coalesced) {
+                writer.edge(edge, count, options.coalesceEdges);
+            }
+            if (stats) {
+                stats->edges += coalesced.size();
+            }
+        }
+        writer.endScope();
+        if (stats && depth == 1) {
+            stats->subgraphTimes.back().time +=
+                std::chrono::steady_clock::now() - topLevelStart;
+        }
+    }
+
+    void vertex(SnapshotVertex vertex) {
+        if (stats) {
+            ++stats->vertices;
+        }
+        writer.beginScope(ScopeKind::Bracket, vertex.id(), false,
+                          vertex.font());
+        writer.commonDecls(vertex);
+        writer.endScope();
+    }
+};
+
+} // namespace
+
+void graphgen::generate(Snapshot const& snapshot,
+                        Sink& sink,
+                        GenerateOptions const& options) {
+    auto start = std::chrono::steady_clock::now();
+    size_t startBytes = sink.bytesWritten();
+    auto root = snapshot.root();
+    std::optional<IDMap<size_t>> names;
+    if (options.compactIDs) {
+        SnapshotNamer namer{ names.emplace(), {} };
+        walk(root, namer);
+        if (options.idMapping) {
+            for (size_t i = 0; i < namer.order.size(); ++i) {
+                *options.idMapping << 'v' << i << ' ' << namer.order[i].raw()
+                                   << '\n';
+            }
+            options.idMapping->flush();
+        }
+    }
+    GenerateStats* stats = options.stats;
+    if (stats) {
+        *stats = {};
+    }
+    DotWriter writer(sink, root.kind());
+    writer.names = names ? &*names : nullptr;
+    SnapshotGenerator generator{ writer, options, stats, {}, {} };
+    walk(root, generator);
+    sink.flush();
+    if (stats) {
+        stats->bytesWritten = sink.bytesWritten() - startBytes;
+        stats->totalTime = std::chrono::steady_clock::now() - start;
+    }
+}
+
+void graphgen::generate(Snapshot const& snapshot,
+                        std::ostream& ostream,
+                        GenerateOptions const& options) {
+    OStreamSink sink(ostream);
+    generate(snapshot, sink, options);
+}
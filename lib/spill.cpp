@@ -0,0 +1,297 @@
+#include "spill.h"
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#include <process.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+
+using namespace graphgen;
+
+/// Contents of the spill file. Values are stored in native byte order, the
+/// file never outlives the process that wrote it. Graphs are stored in pre
+/// order, a graph record is followed by its vertices and then by its edges:
+/// ```
+///  vertex: kind:u8 id:u64 shape:u8 color:u8 style:u8 labelKind:u8
+///          labelSize:u32 label fontSize:u32 font
+///  graph:  vertex graphKind:u8 rankdir:u8 numVertices:u64
+///          vertices... numEdges:u64 edges...
+///  edge:   from:u64 to:u64 color:u8 style:u8
+/// ```
+/// A font size of `UINT32_MAX` means the vertex has no font override. Colors
+/// and styles are stored as value + 1, 0 means no override
+namespace {
+
+constexpr uint32_t NoFont = ~uint32_t(0);
+
+template <typename T>
+void put(Sink& sink, T value) {
+    sink.write({ reinterpret_cast<char const*>(&value), sizeof value });
+}
+
+template <typename E>
+uint8_t encode(std::optional<E> value) {
+    return value ? static_cast<uint8_t>(static_cast<int>(*value) + 1) : 0;
+}
+
+template <typename E>
+std::optional<E> decode(uint8_t value) {
+    if (!value) {
+        return std::nullopt;
+    }
+    return static_cast<E>(value - 1);
+}
+
+struct Reader {
+    char const* pos;
+    char const* end;
+
+    template <typename T>
+    T get() {
+        assert(static_cast<size_t>(end - pos) >= sizeof(T));
+        T value;
+        std::memcpy(&value, pos, sizeof value);
+        pos += sizeof value;
+        return value;
+    }
+
+    std::string_view text(size_t size) {
+        assert(static_cast<size_t>(end - pos) >= size);
+        std::string_view result(pos, size);
+        pos += size;
+        return result;
+    }
+};
+
+} // namespace
+
+static void writeAll(int fd, char const* data, size_t size) {
+    while (size > 0) {
+#if defined(_WIN32)
+        auto result = ::_write(fd, data, static_cast<unsigned>(size));
+#else
+        auto result = ::write(fd, data, size);
+#endif
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(errno,
+                                    std::generic_category(),
+                                    "Failed to write spill file");
+        }
+        data += result;
+        size -= static_cast<size_t>(result);
+    }
+}
+
+static void readAll(int fd, char* data, size_t size, uint64_t offset) {
+#if defined(_WIN32)
+    if (::_lseeki64(fd, static_cast<__int64>(offset), SEEK_SET) < 0) {
+        throw std::system_error(errno,
+                                std::generic_category(),
+                                "Failed to read spill file");
+    }
+#endif
+    while (size > 0) {
+#if defined(_WIN32)
+        auto result = ::_read(fd, data, static_cast<unsigned>(size));
+#else
+        auto result = ::pread(fd, data, size, static_cast<off_t>(offset));
+#endif
+        if (result <= 0) {
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            throw std::system_error(result < 0 ? errno : EIO,
+                                    std::generic_category(),
+                                    "Failed to read spill file");
+        }
+        data += result;
+        size -= static_cast<size_t>(result);
+        offset += static_cast<uint64_t>(result);
+    }
+}
+
+static int createTemporary(std::filesystem::path const& directory) {
+#if defined(_WIN32)
+    static std::atomic<unsigned> counter = 0;
+    auto path = directory / ("graphgen-spill-" + std::to_string(::_getpid()) +
+                             "-" + std::to_string(counter++));
+    int fd = ::_wopen(path.c_str(),
+                      _O_RDWR | _O_CREAT | _O_EXCL | _O_BINARY | _O_TEMPORARY,
+                      _S_IREAD | _S_IWRITE);
+#else
+    std::string path = (directory / "graphgen-spill-XXXXXX").string();
+    int fd = ::mkstemp(path.data());
+    if (fd >= 0) {
+        ::unlink(path.c_str());
+    }
+#endif
+    if (fd < 0) {
+        throw std::system_error(errno,
+                                std::generic_category(),
+                                "Failed to create spill file in " +
+                                    directory.string());
+    }
+    return fd;
+}
+
+SpillFile::SpillFile(std::filesystem::path const& directory):
+    _fd(createTemporary(directory)) {}
+
+SpillFile::~SpillFile() {
+#if defined(_WIN32)
+    ::_close(_fd);
+#else
+    ::close(_fd);
+#endif
+}
+
+SpillSegment SpillFile::write(Graph const& graph) {
+    _buffer.clear();
+    auto writeVertex = [&](Vertex const& vertex) {
+        put(_buffer, vertex.vertexKind());
+        put(_buffer, static_cast<uint64_t>(vertex.id().raw()));
+        put(_buffer, static_cast<uint8_t>(vertex.shape()));
+        put(_buffer, encode(vertex.color()));
+        put(_buffer, encode(vertex.style()));
+        put(_buffer, vertex.label().kind());
+        _text.clear();
+        vertex.label().writeText(_text);
+        put(_buffer, static_cast<uint32_t>(_text.size()));
+        _buffer.write(_text.view());
+        auto font = vertex.font();
+        put(_buffer, font ? static_cast<uint32_t>(font->size()) : NoFont);
+        if (font) {
+            _buffer.write(*font);
+        }
+    };
+    auto writeGraph = [&](Graph const& graph) {
+        writeVertex(graph);
+        put(_buffer, static_cast<uint8_t>(graph.kind()));
+        put(_buffer, static_cast<uint8_t>(graph.rankdir()));
+        put(_buffer, static_cast<uint64_t>(graph.vertices().size()));
+    };
+    auto writeEdges = [&](Graph const& graph) {
+        put(_buffer, static_cast<uint64_t>(graph.edges().size()));
+        for (Edge edge: graph.edges()) {
+            put(_buffer, static_cast<uint64_t>(edge.from.raw()));
+            put(_buffer, static_cast<uint64_t>(edge.to.raw()));
+            put(_buffer, encode(edge.color));
+            put(_buffer, encode(edge.style));
+        }
+    };
+    struct Frame {
+        Graph const* graph;
+        size_t next;
+    };
+    writeGraph(graph);
+    std::vector<Frame> stack = { { &graph, 0 } };
+    while (!stack.empty()) {
+        auto& frame = stack.back();
+        auto vertices = frame.graph->vertices();
+        if (frame.next == vertices.size()) {
+            writeEdges(*frame.graph);
+            stack.pop_back();
+            continue;
+        }
+        Vertex const* vertex = vertices[frame.next++];
+        if (auto* subgraph = vertex->asGraph()) {
+            writeGraph(*subgraph);
+            stack.push_back({ subgraph, 0 });
+        }
+        else {
+            writeVertex(*vertex);
+        }
+    }
+    SpillSegment segment{ _size, _buffer.size() };
+    writeAll(_fd, _buffer.view().data(), _buffer.size());
+    _size += segment.size;
+    return segment;
+}
+
+std::unique_ptr<Graph> SpillFile::read(SpillSegment segment) const {
+    std::vector<char> data(segment.size);
+    readAll(_fd, data.data(), data.size(), segment.offset);
+    Reader reader{ data.data(), data.data() + data.size() };
+    auto readVertex = [&](Vertex& vertex) {
+        auto shape = static_cast<VertexShape>(reader.get<uint8_t>());
+        auto color = decode<Color>(reader.get<uint8_t>());
+        auto style = decode<Style>(reader.get<uint8_t>());
+        auto labelKind = reader.get<LabelKind>();
+        auto label = reader.text(reader.get<uint32_t>());
+        uint32_t fontSize = reader.get<uint32_t>();
+        std::optional<std::string_view> font;
+        if (fontSize != NoFont) {
+            font = reader.text(fontSize);
+        }
+        vertex.label(Label(label, labelKind))
+            ->shape(shape)
+            ->font(font)
+            ->color(color)
+            ->style(style);
+    };
+    auto readGraph = [&](Graph& graph) {
+        readVertex(graph);
+        graph.kind(static_cast<GraphKind>(reader.get<uint8_t>()));
+        graph.rankdir(static_cast<RankDir>(reader.get<uint8_t>()));
+        return reader.get<uint64_t>();
+    };
+    auto readEdges = [&](Graph& graph) {
+        uint64_t count = reader.get<uint64_t>();
+        graph.reserveEdges(count);
+        for (uint64_t i = 0; i < count; ++i) {
+            ID from = reader.get<uint64_t>();
+            ID to = reader.get<uint64_t>();
+            auto color = decode<Color>(reader.get<uint8_t>());
+            auto style = decode<Style>(reader.get<uint8_t>());
+            graph.add(Edge{ from, to, color, style });
+        }
+    };
+    struct Frame {
+        Graph* graph;
+        uint64_t remaining;
+    };
+    [[maybe_unused]] auto kind = reader.get<VertexKind>();
+    assert(kind == VertexKind::Graph);
+    auto result = std::make_unique<Graph>(reader.get<uint64_t>());
+    std::vector<Frame> stack = { { result.get(), readGraph(*result) } };
+    while (!stack.empty()) {
+        auto& frame = stack.back();
+        if (frame.remaining == 0) {
+            readEdges(*frame.graph);
+            stack.pop_back();
+            continue;
+        }
+        --frame.remaining;
+        Graph* parent = frame.graph;
+        auto kind = reader.get<VertexKind>();
+        ID id = reader.get<uint64_t>();
+        switch (kind) {
+        case VertexKind::Vertex:
+            readVertex(*parent->emplace<Vertex>(id));
+            break;
+        case VertexKind::Graph: {
+            auto* graph = parent->emplace<Graph>(id);
+            stack.push_back({ graph, readGraph(*graph) });
+            break;
+        }
+        }
+    }
+    assert(reader.pos == reader.end);
+    return result;
+}
@@ -0,0 +1,68 @@
+#ifndef GRAPHGEN_SPILL_H_
+#define GRAPHGEN_SPILL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <utility>
+
+#include "graphgen/graph.h"
+#include "graphgen/sink.h"
+
+namespace graphgen {
+
+/// Location of the contents of a spilled graph in the spill file
+struct SpillSegment {
+    uint64_t offset;
+    uint64_t size;
+};
+
+/// Append-only temporary file that holds the contents of spilled subgraphs.
+/// The file is removed from the file system as soon as it is created, so it
+/// disappears with the process even if it is not closed
+class SpillFile {
+public:
+    /// Creates the file in \p directory
+    explicit SpillFile(std::filesystem::path const& directory);
+
+    SpillFile(SpillFile const&) = delete;
+
+    SpillFile& operator=(SpillFile const&) = delete;
+
+    ~SpillFile();
+
+    /// Appends \p graph, its attributes and everything below it to the file.
+    /// Generated labels are evaluated and stored as text
+    SpillSegment write(Graph const& graph);
+
+    /// Reads the graph in \p segment back into a new graph tree
+    std::unique_ptr<Graph> read(SpillSegment segment) const;
+
+private:
+    int _fd = -1;
+    uint64_t _size = 0;
+    BufferSink _buffer;
+    BufferSink _text;
+};
+
+/// Memory budget of a graph. Kept by the graph whose subgraphs are spilled
+struct SpillState {
+    size_t budget;
+    std::filesystem::path directory;
+
+    /// Estimated size of the finished subgraphs that are still in memory
+    size_t resident = 0;
+
+    /// Finished subgraphs that are still in memory and their estimated size
+    /// in the order they were finished
+    std::deque<std::pair<Graph*, size_t>> finished;
+
+    /// Opened when the first subgraph is spilled
+    std::unique_ptr<SpillFile> file;
+};
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_SPILL_H_
@@ -0,0 +1,88 @@
+#include "graphgen/streaming.h"
+
+#include <cassert>
+
+#include "dotwriter.h"
+#include "graphgen/sink.h"
+
+using namespace graphgen;
+
+StreamingGraphWriter::StreamingGraphWriter(Sink& sink, GraphKind kind):
+    _writer(std::make_unique<DotWriter>(sink, kind)),
+    _strings(std::make_unique<StringPool>()) {}
+
+StreamingGraphWriter::~StreamingGraphWriter() = default;
+
+StreamingGraphWriter::Element* StreamingGraphWriter::beginGraph(ID id) {
+    assert(_writer->depth() == 0 && _pending == Pending::None &&
+           "Root graph has already been opened");
+    return declare(Pending::Graph, id);
+}
+
+void StreamingGraphWriter::endGraph() {
+    writePending();
+    assert(_writer->depth() == 1 && "Unbalanced subgraphs");
+    _writer->endScope();
+    _writer->str.flush();
+}
+
+StreamingGraphWriter::Element* StreamingGraphWriter::beginSubgraph(ID id) {
+    assert((_writer->depth() > 0 || _pending == Pending::Graph) &&
+           "Subgraphs must be declared in a graph");
+    return declare(Pending::Graph, id);
+}
+
+void StreamingGraphWriter::endSubgraph() {
+    writePending();
+    assert(_writer->depth() > 1 && "No open subgraph");
+    _writer->endScope();
+}
+
+StreamingGraphWriter::Element* StreamingGraphWriter::vertex(ID id) {
+    assert((_writer->depth() > 0 || _pending == Pending::Graph) &&
+           "Vertices must be declared in a graph");
+    return declare(Pending::Vertex, id);
+}
+
+void StreamingGraphWriter::edge(Edge const& edge) {
+    writePending();
+    _writer->edge(edge);
+}
+
+size_t StreamingGraphWriter::depth() const {
+    return _writer->depth() + (_pending == Pending::Graph ? 1 : 0);
+}
+
+StreamingGraphWriter::Element* StreamingGraphWriter::declare(Pending kind,
+                                                             ID id) {
+    writePending();
+    _pending = kind;
+    _pendingID = id;
+    _element = Element{};
+    _element._strings = _strings.get();
+    return &_element;
+}
+
+void StreamingGraphWriter::writePending() {
+    switch (_pending) {
+    case Pending::None:
+        return;
+    case Pending::Graph:
+        _writer->beginScope(ScopeKind::Brace,
+                            _pendingID,
+                            _writer->depth() == 0,
+                            _element.font());
+        _writer->commonDecls(_element);
+        _writer->line("rankdir = ", _element.rankdir());
+        break;
+    case Pending::Vertex:
+        _writer->beginScope(ScopeKind::Bracket,
+                            _pendingID,
+                            false,
+                            _element.font());
+        _writer->commonDecls(_element);
+        _writer->endScope();
+        break;
+    }
+    _pending = Pending::None;
+}
@@ -0,0 +1,133 @@
+#include "threadpool.h"
+
+#include <algorithm>
+#include <utility>
+
+using namespace graphgen;
+
+namespace {
+
+struct Participant {
+    ThreadPool const* pool = nullptr;
+    size_t index = 0;
+};
+
+} // namespace
+
+static thread_local Participant currentParticipant;
+
+ThreadPool::ThreadPool(size_t numThreads) {
+    numThreads = std::max<size_t>(numThreads, 1);
+    for (size_t i = 0; i < numThreads; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    // Queue 0 belongs to the thread that calls `wait()`
+    for (size_t i = 1; i < numThreads; ++i) {
+        threads.emplace_back([this, i] { workerMain(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(sleepMutex);
+        stopping = true;
+    }
+    wakeWorkers.notify_all();
+    for (auto& thread: threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    size_t index = currentParticipant.pool == this ?
+                       currentParticipant.index :
+                       nextQueue.fetch_add(1) % queues.size();
+    pending.fetch_add(1);
+    {
+        auto& queue = *queues[index];
+        std::lock_guard lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard lock(sleepMutex);
+        ++queued;
+    }
+    wakeWorkers.notify_one();
+    wakeWaiter.notify_one();
+}
+
+void ThreadPool::wait() {
+    auto previous = currentParticipant;
+    currentParticipant = { this, 0 };
+    while (pending.load() > 0) {
+        if (runOne(0)) {
+            continue;
+        }
+        std::unique_lock lock(sleepMutex);
+        wakeWaiter.wait(lock, [&] { return pending.load() == 0 || queued > 0; });
+    }
+    currentParticipant = previous;
+    std::lock_guard lock(errorMutex);
+    if (auto e = std::exchange(error, nullptr)) {
+        std::rethrow_exception(e);
+    }
+}
+
+void ThreadPool::workerMain(size_t index) {
+    currentParticipant = { this, index };
+    while (true) {
+        if (runOne(index)) {
+            continue;
+        }
+        std::unique_lock lock(sleepMutex);
+        wakeWorkers.wait(lock, [&] { return stopping || queued > 0; });
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::runOne(size_t index) {
+    std::function<void()> task;
+    if (!pop(index, task)) {
+        return false;
+    }
+    try {
+        task();
+    }
+    catch (...) {
+        std::lock_guard lock(errorMutex);
+        if (!error) {
+            error = std::current_exception();
+        }
+    }
+    if (pending.fetch_sub(1) == 1) {
+        std::lock_guard lock(sleepMutex);
+        wakeWaiter.notify_all();
+    }
+    return true;
+}
+
+bool ThreadPool::pop(size_t index, std::function<void()>& task) {
+    // Own queue is processed LIFO for locality, other queues are robbed FIFO
+    // so thieves take the oldest and usually largest tasks
+    for (size_t i = 0; i < queues.size(); ++i) {
+        auto& queue = *queues[(index + i) % queues.size()];
+        std::lock_guard lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+        if (i == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        std::lock_guard sleepLock(sleepMutex);
+        --queued;
+        return true;
+    }
+    return false;
+}
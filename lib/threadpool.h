@@ -0,0 +1,69 @@
+#ifndef GRAPHGEN_THREADPOOL_H_
+#define GRAPHGEN_THREADPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace graphgen {
+
+/// Work stealing thread pool. Every participant owns a task queue. Tasks
+/// submitted from a worker go to the worker's own queue, idle workers steal
+/// from the other queues. The thread calling `wait()` participates in running
+/// tasks
+class ThreadPool {
+public:
+    /// Creates a pool with \p numThreads participants including the thread
+    /// that calls `wait()`, i.e. `numThreads - 1` threads are spawned
+    explicit ThreadPool(size_t numThreads);
+
+    ThreadPool(ThreadPool const&) = delete;
+
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    /// Joins all threads. Pending tasks are discarded
+    ~ThreadPool();
+
+    /// Schedules \p task for execution
+    void submit(std::function<void()> task);
+
+    /// Runs tasks until all submitted tasks have completed. If a task threw
+    /// an exception, the first such exception is rethrown here
+    void wait();
+
+    /// \Returns the number of participants
+    size_t size() const { return queues.size(); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void workerMain(size_t index);
+    bool runOne(size_t index);
+    bool pop(size_t index, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> nextQueue = 0;
+    std::atomic<size_t> pending = 0;
+    std::mutex sleepMutex;
+    std::ptrdiff_t queued = 0;
+    std::condition_variable wakeWorkers;
+    std::condition_variable wakeWaiter;
+    bool stopping = false;
+    std::mutex errorMutex;
+    std::exception_ptr error;
+};
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_THREADPOOL_H_
@@ -0,0 +1,83 @@
+#ifndef GRAPHGEN_TRAVERSAL_H_
+#define GRAPHGEN_TRAVERSAL_H_
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "graphgen/graph.h"
+
+namespace graphgen {
+
+/// Callbacks of `traverse()`. Passes derive from this and hide the functions
+/// they are interested in. Calls are resolved statically, so there is no
+/// virtual dispatch per vertex
+struct TraversalCallbacks {
+    /// Called before the vertices of \p graph. Returning `false` skips the
+    /// vertices of \p graph and the matching call to `leaveGraph()`
+    bool enterGraph(Graph const& /* graph */) { return true; }
+
+    /// Called after the vertices of \p graph
+    void leaveGraph(Graph const& /* graph */) {}
+
+    /// Called for every vertex that is not a graph
+    void vertex(Vertex const& /* vertex */) {}
+};
+
+/// Walks the tree below \p root depth first in declaration order and invokes
+/// the callbacks of \p callbacks. Vertices are dispatched on their
+/// `VertexKind` and the path from \p root is kept in an explicit stack, so
+/// arbitrarily deep nesting does not overflow the call stack. Spilled
+/// subgraphs are read back when they are reached and the copy is visited in
+/// their place, so callbacks must not keep references to a subgraph or its
+/// vertices after `leaveGraph()` of the subgraph
+template <typename C>
+void traverse(Graph const& root, C& callbacks) {
+    struct Frame {
+        Graph const* graph;
+        size_t next;
+        std::unique_ptr<Graph> loaded;
+    };
+    if (!callbacks.enterGraph(root)) {
+        return;
+    }
+    std::vector<Frame> stack;
+    stack.push_back({ &root, 0, nullptr });
+    while (!stack.empty()) {
+        auto& frame = stack.back();
+        auto vertices = frame.graph->vertices();
+        if (frame.next == vertices.size()) {
+            Graph const* graph = frame.graph;
+            auto loaded = std::move(frame.loaded);
+            stack.pop_back();
+            callbacks.leaveGraph(*graph);
+            continue;
+        }
+        Vertex const* vertex = vertices[frame.next++];
+        switch (vertex->vertexKind()) {
+        case VertexKind::Vertex:
+            callbacks.vertex(*vertex);
+            break;
+        case VertexKind::Graph: {
+            auto& graph = static_cast<Graph const&>(*vertex);
+            if (!graph.isSpilled()) {
+                if (callbacks.enterGraph(graph)) {
+                    stack.push_back({ &graph, 0, nullptr });
+                }
+                break;
+            }
+            auto loaded = graph.readSpilled();
+            if (callbacks.enterGraph(*loaded)) {
+                Graph const* copy = loaded.get();
+                stack.push_back({ copy, 0, std::move(loaded) });
+            }
+            break;
+        }
+        }
+    }
+}
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_TRAVERSAL_H_
@@ -2,6 +2,7 @@
 #define GRAPHGEN_UTIL_H_
 
 #include <concepts>
+#include <functional>
 #include <iosfwd>
 #include <type_traits>
 
@@ -13,7 +14,11 @@ struct ScopeGuard {
 
     ScopeGuard(ScopeGuard&&) = delete;
 
-    constexpr ~ScopeGuard() { std::invoke(function); }
+    /// Exceptions of \p function propagate, e.g. errors of a sink when the
+    /// closing code of a scope is written
+    constexpr ~ScopeGuard() noexcept(std::is_nothrow_invocable_v<F&>) {
+        std::invoke(function);
+    }
 
     F function;
 };
@@ -47,18 +52,16 @@ public:
     constexpr auto operator()(Args&&... args) const {
         return graphgen::StreamManip(
             [args = std::tuple{ ObjWrapper{ std::forward<Args>(args) }... },
-             f = function](std::ostream& ostream) {
+             f = function](auto& ostream) {
             std::apply(
                 [&](auto&... args) { std::invoke(f, ostream, args.obj...); },
                 args);
         });
     }
 
-    template <typename CharT, typename Traits>
-        requires std::invocable<F, std::basic_ostream<CharT, Traits>&>
-    friend std::basic_ostream<CharT, Traits>& operator<<(
-        std::basic_ostream<CharT, Traits>& ostream,
-        StreamManip<F> const& manip) {
+    template <typename Stream>
+        requires std::invocable<F, Stream&>
+    friend Stream& operator<<(Stream& ostream, StreamManip<F> const& manip) {
         std::invoke(manip.function, ostream);
         return ostream;
     }
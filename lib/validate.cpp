@@ -0,0 +1,85 @@
+#include "graphgen/validate.h"
+
+#include <string>
+
+#include "escape.h"
+#include "traversal.h"
+
+using namespace graphgen;
+
+/// Vertices inside of spilled subgraphs are found as the spilled subgraph
+static bool isVertex(Vertex const* vertex) {
+    if (!vertex) {
+        return false;
+    }
+    auto* graph = vertex->asGraph();
+    return !graph || graph->isSpilled();
+}
+
+namespace {
+
+struct Validator: TraversalCallbacks {
+    Graph const& root;
+    ValidationResult& result;
+
+    Validator(Graph const& root, ValidationResult& result):
+        root(root), result(result) {}
+
+    void checkLabel(Vertex const& vertex) {
+        auto& label = vertex.label();
+        if (label.kind() == LabelKind::HTML && !label.isGenerated() &&
+            !isBalancedHTML(label.text()))
+        {
+            result.malformedLabels.push_back(vertex.id());
+        }
+    }
+
+    bool enterGraph(Graph const& graph) {
+        checkLabel(graph);
+        for (Edge edge: graph.edges()) {
+            if (!isVertex(root.find(edge.from)) ||
+                !isVertex(root.find(edge.to)))
+            {
+                result.danglingEdges.push_back(edge);
+            }
+        }
+        return true;
+    }
+
+    void vertex(Vertex const& vertex) { checkLabel(vertex); }
+};
+
+} // namespace
+
+ValidationResult graphgen::validate(Graph const& graph) {
+    ValidationResult result;
+    auto duplicates = graph.duplicateIDs();
+    result.duplicateIDs.assign(duplicates.begin(), duplicates.end());
+    Validator validator(graph, result);
+    traverse(graph, validator);
+    return result;
+}
+
+static std::string makeMessage(ValidationResult const& result) {
+    std::string message = "Invalid graph:";
+    if (!result.duplicateIDs.empty()) {
+        message += " " + std::to_string(result.duplicateIDs.size()) +
+                   " duplicate IDs (first: " +
+                   std::to_string(result.duplicateIDs.front().raw()) + ")";
+    }
+    if (!result.danglingEdges.empty()) {
+        auto& edge = result.danglingEdges.front();
+        message += " " + std::to_string(result.danglingEdges.size()) +
+                   " dangling edges (first: " + std::to_string(edge.from.raw()) +
+                   " -> " + std::to_string(edge.to.raw()) + ")";
+    }
+    if (!result.malformedLabels.empty()) {
+        message += " " + std::to_string(result.malformedLabels.size()) +
+                   " malformed HTML labels (first: " +
+                   std::to_string(result.malformedLabels.front().raw()) + ")";
+    }
+    return message;
+}
+
+InvalidGraphError::InvalidGraphError(ValidationResult result):
+    std::runtime_error(makeMessage(result)), _result(std::move(result)) {}
@@ -0,0 +1,18 @@
+#include "vertexindex.h"
+
+using namespace graphgen;
+
+bool VertexIndex::insert(Vertex* vertex) {
+    bool inserted = map.insert(vertex->id(), vertex).second;
+    if (!inserted) {
+        duplicateIDs.push_back(vertex->id());
+    }
+    return inserted;
+}
+
+void VertexIndex::merge(VertexIndex const& other) {
+    other.map.forEach([this](ID, Vertex* vertex) { insert(vertex); });
+    duplicateIDs.insert(duplicateIDs.end(),
+                        other.duplicateIDs.begin(),
+                        other.duplicateIDs.end());
+}
@@ -0,0 +1,54 @@
+#ifndef GRAPHGEN_VERTEXINDEX_H_
+#define GRAPHGEN_VERTEXINDEX_H_
+
+#include <span>
+#include <vector>
+
+#include "graphgen/graph.h"
+#include "idmap.h"
+
+namespace graphgen {
+
+/// Index from vertex IDs to vertices. The first vertex inserted with an ID
+/// wins, IDs of later vertices with the same ID are recorded as duplicates
+class VertexIndex {
+public:
+    /// Inserts \p vertex. \Returns `false` if a vertex with the same ID has
+    /// already been inserted
+    bool insert(Vertex* vertex);
+
+    /// Inserts all vertices and duplicates of \p other
+    void merge(VertexIndex const& other);
+
+    /// Makes the entry of the ID of \p vertex refer to \p target if it
+    /// currently refers to \p vertex
+    void redirect(Vertex const* vertex, Vertex* target) {
+        auto* entry = map.find(vertex->id());
+        if (entry && *entry == vertex) {
+            *entry = target;
+        }
+    }
+
+    /// Reserves space for \p size vertices
+    void reserve(size_t size) { map.reserve(size); }
+
+    /// \Returns the vertex with ID \p id or null if there is none
+    Vertex* find(ID id) const {
+        auto* result = map.find(id);
+        return result ? *result : nullptr;
+    }
+
+    /// \Returns the number of distinct IDs
+    size_t size() const { return map.size(); }
+
+    /// \Returns the IDs that have been inserted more than once
+    std::span<ID const> duplicates() const { return duplicateIDs; }
+
+private:
+    IDMap<Vertex*> map;
+    std::vector<ID> duplicateIDs;
+};
+
+} // namespace graphgen
+
+#endif // GRAPHGEN_VERTEXINDEX_H_
@@ -0,0 +1,69 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <string>
+
+#include <graphgen/graphgen.h>
+
+using namespace graphgen;
+
+namespace {
+
+/// Vertex type that counts how often it is destroyed
+class CountingVertex: public Vertex {
+public:
+    using Vertex::Vertex;
+
+    ~CountingVertex() override { ++destroyed; }
+
+    static inline int destroyed = 0;
+};
+
+} // namespace
+
+TEST_CASE("Arena allocates objects with their alignment", "[arena]") {
+    Arena arena;
+    CHECK(arena.numChunks() == 0);
+    for (int i = 0; i < 1000; ++i) {
+        auto* c = arena.create<char>('a');
+        auto* d = arena.create<double>(1.0);
+        CHECK(*c == 'a');
+        CHECK(reinterpret_cast<uintptr_t>(d) % alignof(double) == 0);
+    }
+    void* large = arena.allocate(size_t(8) << 20, 64);
+    CHECK(reinterpret_cast<uintptr_t>(large) % 64 == 0);
+    CHECK(arena.capacity() >= (size_t(8) << 20));
+    Arena other;
+    other.create<int>(1);
+    size_t chunks = arena.numChunks() + other.numChunks();
+    arena.absorb(other);
+    CHECK(arena.numChunks() == chunks);
+    CHECK(other.numChunks() == 0);
+}
+
+TEST_CASE("Destroying a graph destroys vertices that own resources",
+          "[arena]") {
+    CountingVertex::destroyed = 0;
+    std::string longText(100, 'x');
+    {
+        Graph graph(0);
+        auto* subgraph = graph.emplace<Graph>(1);
+        for (int i = 0; i < 1000; ++i) {
+            subgraph->emplace<Vertex>(10 + 5 * i)->label("short");
+            subgraph->emplace<Vertex>(11 + 5 * i)->label(longText);
+            subgraph->emplace<Vertex>(12 + 5 * i)->label(
+                [](std::ostream& str) { str << "generated"; });
+            subgraph->emplace<Vertex>(13 + 5 * i)->font("Mono");
+            subgraph->emplace<CountingVertex>(14 + 5 * i);
+        }
+        graph.add(Vertex::make(2)->label(longText));
+        // Configured before it is added, so it owns a copy of its font first
+        auto* loose = new Vertex(3);
+        loose->font("Loose");
+        graph.add(loose);
+        CHECK(graph.find(11)->label().text() == longText);
+    }
+    // Owned labels, generators and fonts are released by the destructors,
+    // which the leak checker verifies in sanitizer builds
+    CHECK(CountingVertex::destroyed == 1000);
+}
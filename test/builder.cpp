@@ -0,0 +1,104 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <graphgen/graphgen.h>
+
+#include "common.h"
+
+using namespace graphgen;
+using namespace graphgen::test;
+
+static constexpr int NumThreads = 8;
+static constexpr int PerThread = 500;
+
+/// Builds a graph with one subgraph per thread. Every thread also adds
+/// vertices and edges to the subgraph of the next thread, which may not exist
+/// yet. Shards are obtained in thread order, so the result is reproducible
+static std::unique_ptr<Graph> buildConcurrently() {
+    ConcurrentGraphBuilder builder(0);
+    std::atomic<int> turn = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < NumThreads; ++t) {
+        threads.emplace_back([&, t] {
+            while (turn != t) {
+                std::this_thread::yield();
+            }
+            auto& shard = builder.shard();
+            ++turn;
+            ID own = 1000 + t, next = 1000 + (t + 1) % NumThreads;
+            shard.emplace<Graph>(0, own)->label("Thread " + std::to_string(t));
+            for (int i = 0; i < PerThread; ++i) {
+                int id = 10000 * (t + 1) + i;
+                shard.emplace(i % 2 ? own : next, id)->label(std::to_string(i));
+                if (i > 0) {
+                    builder.add(0, Edge{ id - 1, id });
+                }
+            }
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+    return builder.build();
+}
+
+TEST_CASE("ConcurrentGraphBuilder collects appends of all threads",
+          "[builder]") {
+    auto graph = buildConcurrently();
+    CHECK(validate(*graph).ok());
+    CHECK(graph->vertices().size() == NumThreads);
+    CHECK(graph->edges().size() == size_t(NumThreads * (PerThread - 1)));
+    for (int t = 0; t < NumThreads; ++t) {
+        auto* subgraph = graph->find(1000 + t);
+        REQUIRE(subgraph);
+        CHECK(subgraph->parent() == graph.get());
+        CHECK(subgraph->asGraph()->vertices().size() == PerThread);
+        for (int i = 0; i < PerThread; ++i) {
+            auto* vertex = graph->find(10000 * (t + 1) + i);
+            REQUIRE(vertex);
+            ID parent = 1000 + (i % 2 ? t : (t + 1) % NumThreads);
+            CHECK(vertex->parent()->id() == parent);
+        }
+    }
+    CHECK(generateString(*buildConcurrently()) == generateString(*graph));
+}
+
+TEST_CASE("Threads can feed several builders alternately", "[builder]") {
+    ConcurrentGraphBuilder first(0), second(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 100; ++i) {
+                int id = 1000 * (t + 1) + i;
+                first.emplace(0, id);
+                second.emplace(0, id)->label("second");
+            }
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+    auto a = first.build();
+    auto b = second.build();
+    CHECK(a->vertices().size() == 400);
+    CHECK(b->vertices().size() == 400);
+    CHECK(validate(*a).ok());
+    CHECK(validate(*b).ok());
+    CHECK(b->find(1000)->label().text() == "second");
+}
+
+TEST_CASE("ConcurrentGraphBuilder rejects invalid trees", "[builder]") {
+    ConcurrentGraphBuilder builder(0);
+    builder.emplace(5, 1);
+    CHECK_THROWS_AS(builder.build(), std::runtime_error);
+    builder.emplace<Graph>(0, 5);
+    auto graph = builder.build();
+    REQUIRE(graph->find(1));
+    CHECK(graph->find(1)->parent()->id() == ID(5));
+}
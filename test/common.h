@@ -0,0 +1,69 @@
+#ifndef GRAPHGEN_TEST_COMMON_H_
+#define GRAPHGEN_TEST_COMMON_H_
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include <graphgen/graphgen.h>
+
+namespace graphgen::test {
+
+/// \Returns the code generated for \p graph as a string. \p graph is a
+/// `Graph` or a `Snapshot`
+template <typename G>
+std::string generateString(G const& graph,
+                           GenerateOptions const& options = {}) {
+    BufferSink sink;
+    generate(graph, sink, options);
+    return std::string(sink.view());
+}
+
+/// \Returns the contents of the file at \p path
+inline std::string readFile(std::filesystem::path const& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream str;
+    str << file.rdbuf();
+    return str.str();
+}
+
+/// Empty directory that is removed with all its contents on destruction
+class TemporaryDirectory {
+public:
+    TemporaryDirectory() {
+        static std::atomic<int> counter = 0;
+        auto stamp = std::chrono::steady_clock::now().time_since_epoch();
+        _path = std::filesystem::temp_directory_path() /
+                ("graphgen-test-" + std::to_string(stamp.count()) + "-" +
+                 std::to_string(counter++));
+        std::filesystem::remove_all(_path);
+        std::filesystem::create_directories(_path);
+    }
+
+    TemporaryDirectory(TemporaryDirectory const&) = delete;
+
+    TemporaryDirectory& operator=(TemporaryDirectory const&) = delete;
+
+    ~TemporaryDirectory() {
+        std::error_code error;
+        std::filesystem::remove_all(_path, error);
+    }
+
+    /// \Returns the path of the directory
+    std::filesystem::path const& path() const { return _path; }
+
+    /// \Returns the path of the file \p name in the directory
+    std::filesystem::path operator/(std::string const& name) const {
+        return _path / name;
+    }
+
+private:
+    std::filesystem::path _path;
+};
+
+} // namespace graphgen::test
+
+#endif // GRAPHGEN_TEST_COMMON_H_
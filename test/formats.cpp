@@ -0,0 +1,89 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include <graphgen/graphgen.h>
+
+#include "common.h"
+
+using namespace graphgen;
+using namespace graphgen::test;
+
+/// Builds a directed graph with a nested subgraph, an HTML label, text that
+/// needs escaping and two equal edges
+static std::unique_ptr<Graph> makeGraph() {
+    auto graph = std::make_unique<Graph>(0);
+    graph->kind(GraphKind::Directed);
+    graph->emplace<Vertex>(1)->label("say \"hi\"")->color(Color::Red);
+    auto* subgraph = graph->emplace<Graph>(2);
+    subgraph->label("<b>Sub</b>", LabelKind::HTML);
+    subgraph->emplace<Vertex>(3)->label("a<b & c")->font("Mono");
+    graph->add(Edge{ 1, 3 })->add(Edge{ 1, 3 })->add(
+        Edge{ 3, 1, std::nullopt, Style::Dashed });
+    return graph;
+}
+
+template <Format F>
+static std::string generateString(Graph const& graph,
+                                  GenerateOptions const& options = {}) {
+    BufferSink sink;
+    generate<F>(graph, sink, options);
+    std::ostringstream str;
+    generate<F>(graph, str, options);
+    CHECK(str.str() == sink.view());
+    return std::string(sink.view());
+}
+
+TEST_CASE("JSON output lists nodes and edges", "[formats]") {
+    auto graph = makeGraph();
+    GenerateOptions options;
+    options.coalesceEdges = EdgeCoalescing::Label;
+    CHECK(generateString<Format::Json>(*graph, options) ==
+          R"({"directed":true,"elements":[
+{"group":"nodes","data":{"id":"vertex_1","label":"say \"hi\"","shape":"box","color":"red"}},
+{"group":"nodes","data":{"id":"vertex_2","label":"<b>Sub</b>","html":true,"shape":"box"}},
+{"group":"nodes","data":{"id":"vertex_3","parent":"vertex_2","label":"a<b & c","shape":"box","fontname":"Mono"}},
+{"group":"edges","data":{"source":"vertex_1","target":"vertex_3","count":2}},
+{"group":"edges","data":{"source":"vertex_3","target":"vertex_1","style":"dashed"}}
+]}
+)");
+
+    options.compactIDs = true;
+    std::string compact = generateString<Format::Json>(*graph, options);
+    CHECK(compact.find(R"("id":"v2","parent":"v1")") != std::string::npos);
+    graph->kind(GraphKind::Undirected);
+    CHECK(generateString<Format::Json>(*graph).starts_with(
+        R"({"directed":false,)"));
+}
+
+TEST_CASE("GraphML output nests subgraphs in their nodes", "[formats]") {
+    auto graph = makeGraph();
+    std::string output = generateString<Format::GraphML>(*graph);
+    CHECK(output.starts_with("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"));
+    CHECK(output.ends_with("</graphml>\n"));
+    CHECK(output.find("<graph id=\"G\" edgedefault=\"directed\">") !=
+          std::string::npos);
+    auto node = output.find("<node id=\"vertex_2\">");
+    auto nested = output.find("<graph id=\"vertex_2:\"");
+    auto inner = output.find("<node id=\"vertex_3\">");
+    auto closed = output.find("</node>", inner);
+    REQUIRE(node != std::string::npos);
+    CHECK(node < nested);
+    CHECK(nested < inner);
+    CHECK(output.find("</graph>", closed) <
+          output.find("</node>", closed + 1));
+    CHECK(output.find("<data key=\"label\">say &quot;hi&quot;</data>") !=
+          std::string::npos);
+    CHECK(output.find("<data key=\"label\">a&lt;b &amp; c</data>") !=
+          std::string::npos);
+    CHECK(output.find("<data key=\"html\">true</data>") != std::string::npos);
+    // Edges are not coalesced by default
+    auto first = output.find("<edge source=\"vertex_1\" target=\"vertex_3\"/>");
+    REQUIRE(first != std::string::npos);
+    CHECK(output.find("<edge source=\"vertex_1\" target=\"vertex_3\"/>",
+                      first + 1) != std::string::npos);
+    CHECK(output.find("<data key=\"style\">dashed</data>") !=
+          std::string::npos);
+}
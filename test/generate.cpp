@@ -0,0 +1,292 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <graphgen/graphgen.h>
+
+#include "common.h"
+
+using namespace graphgen;
+using namespace graphgen::test;
+
+/// Builds a graph with \p width subgraphs per level nested \p depth levels
+/// deep, with vertices and edges in every graph
+static std::unique_ptr<Graph> makeNested(int width, int depth) {
+    auto root = std::make_unique<Graph>(0);
+    int nextID = 1;
+    std::vector<std::pair<Graph*, int>> pending = { { root.get(), 0 } };
+    while (!pending.empty()) {
+        auto [graph, level] = pending.back();
+        pending.pop_back();
+        int first = nextID;
+        for (int i = 0; i < 3; ++i) {
+            int id = nextID++;
+            graph->emplace<Vertex>(id)
+                ->label("Vertex " + std::to_string(id))
+                ->shape(i % 2 ? VertexShape::Circle : VertexShape::Box);
+        }
+        graph->add(Edge{ first, first + 1 })->add(
+            Edge{ first + 1, first + 2, Color::Red, Style::Dashed });
+        if (level == depth) {
+            continue;
+        }
+        for (int i = 0; i < width; ++i) {
+            int id = nextID++;
+            auto* subgraph = graph->emplace<Graph>(id);
+            subgraph->label("Graph " + std::to_string(id))->font("Mono");
+            pending.push_back({ subgraph, level + 1 });
+        }
+    }
+    return root;
+}
+
+TEST_CASE("Parallel generation matches serial generation", "[generate]") {
+    auto graph = makeNested(4, 3);
+    std::string serial = generateString(*graph);
+    for (unsigned threads: { 2u, 4u, 8u }) {
+        GenerateOptions options;
+        options.threads = threads;
+        CHECK(generateString(*graph, options) == serial);
+    }
+}
+
+TEST_CASE("Incremental generation only regenerates changed graphs",
+          "[generate]") {
+    Graph graph(0);
+    std::vector<int> calls(3, 0);
+    std::vector<Vertex*> vertices;
+    for (int i = 0; i < 3; ++i) {
+        auto* subgraph = graph.emplace<Graph>(100 + i);
+        subgraph->emplace<Vertex>(200 + i)->label(
+            [&calls, i](std::ostream& str) {
+            ++calls[i];
+            str << "Generated " << i;
+        });
+        vertices.push_back(subgraph->emplace<Vertex>(300 + i)->label("Plain"));
+    }
+    GenerateOptions options;
+    options.incremental = true;
+    std::string first = generateString(graph, options);
+    CHECK(calls == std::vector{ 1, 1, 1 });
+    CHECK(!graph.isDirty());
+    CHECK(generateString(graph, options) == first);
+    CHECK(calls == std::vector{ 1, 1, 1 });
+
+    vertices[1]->label("Changed");
+    CHECK(graph.isDirty());
+    std::string second = generateString(graph, options);
+    CHECK(calls == std::vector{ 1, 2, 1 });
+    CHECK(second != first);
+    CHECK(second == generateString(graph));
+
+    graph.add(Edge{ 300, 302 });
+    std::string third = generateString(graph, options);
+    CHECK(calls == std::vector{ 2, 3, 2 });
+    CHECK(third == generateString(graph));
+}
+
+TEST_CASE("Statistics and observers count every scope", "[generate]") {
+    struct CountingObserver: GenerateObserver {
+        void beginGraph(Graph const&, size_t depth) override {
+            ++graphs;
+            ++open;
+            size_t seen = maxDepth;
+            while (depth > seen && !maxDepth.compare_exchange_weak(seen, depth))
+            {}
+        }
+        void endGraph(Graph const&, size_t) override { --open; }
+        void beginVertex(Vertex const&, size_t) override {
+            ++vertices;
+            ++open;
+        }
+        void endVertex(Vertex const&, size_t) override { --open; }
+
+        std::atomic<size_t> graphs = 0, vertices = 0, maxDepth = 0;
+        std::atomic<int> open = 0;
+    };
+    Graph graph(0);
+    graph.emplace<Vertex>(1);
+    auto* subgraph = graph.emplace<Graph>(2);
+    subgraph->emplace<Vertex>(3);
+    subgraph->emplace<Graph>(4)->emplace<Vertex>(5);
+    graph.add(Edge{ 1, 3 })->add(Edge{ 1, 3 });
+    subgraph->add(Edge{ 3, 5 });
+    for (unsigned threads: { 1u, 4u }) {
+        for (auto coalesce: { EdgeCoalescing::None, EdgeCoalescing::Drop }) {
+            CountingObserver observer;
+            GenerateStats stats;
+            GenerateOptions options;
+            options.threads = threads;
+            options.coalesceEdges = coalesce;
+            options.stats = &stats;
+            options.observer = &observer;
+            std::string output = generateString(graph, options);
+            CHECK(stats.vertices == 3);
+            CHECK(stats.edges == (coalesce == EdgeCoalescing::None ? 3 : 2));
+            CHECK(stats.subgraphs == 2);
+            CHECK(stats.maxDepth == 2);
+            CHECK(stats.bytesWritten == output.size());
+            REQUIRE(stats.subgraphTimes.size() == 1);
+            CHECK(stats.subgraphTimes[0].id == ID(2));
+            CHECK(observer.graphs == 3);
+            CHECK(observer.vertices == 3);
+            CHECK(observer.open == 0);
+            CHECK(observer.maxDepth == 2);
+        }
+    }
+}
+
+TEST_CASE("The most frequent values are hoisted", "[generate]") {
+    Graph graph(0);
+    char const* labels[] = { "A", "A", "B", "C", "D" };
+    for (int i = 0; i < 5; ++i) {
+        graph.emplace<Vertex>(i + 1)->label(labels[i]);
+    }
+    GenerateOptions options;
+    options.hoistDefaults = true;
+    std::string output = generateString(graph, options);
+    CHECK(output.find("node [label = \"A\"") != std::string::npos);
+    CHECK(output.find("label = \"A\"\n") == std::string::npos);
+    CHECK(output.find("label = \"B\"\n") != std::string::npos);
+
+    auto nested = makeNested(3, 2);
+    GenerateOptions parallel = options;
+    parallel.threads = 4;
+    CHECK(generateString(*nested, parallel) ==
+          generateString(*nested, options));
+}
+
+TEST_CASE("Nothing is hoisted if edges have dangling endpoints",
+          "[generate]") {
+    Graph graph(0);
+    graph.emplace<Vertex>(1)->label("A");
+    graph.emplace<Vertex>(2)->label("A");
+    graph.add(Edge{ 1, 3 });
+    GenerateOptions options;
+    options.hoistDefaults = true;
+    CHECK(generateString(graph, options) == generateString(graph));
+    graph.emplace<Vertex>(3)->label("B");
+    CHECK(generateString(graph, options).find("node [label = \"A\"") !=
+          std::string::npos);
+}
+
+TEST_CASE("Plain text labels are escaped", "[generate]") {
+    Graph graph(0);
+    graph.emplace<Vertex>(1)->label("say \"hi\" \\ now\nnext");
+    graph.emplace<Vertex>(2)->label([](std::ostream& str) { str << "a\"b"; });
+    graph.emplace<Vertex>(3)->label("<b>\"as is\"</b>", LabelKind::HTML);
+    graph.emplace<Vertex>(4)->label("left\\l", LabelKind::Escaped);
+    std::string output = generateString(graph);
+    CHECK(output.find(R"(label = "say \"hi\" \\ now\nnext")") !=
+          std::string::npos);
+    CHECK(output.find(R"(label = "a\"b")") != std::string::npos);
+    CHECK(output.find(R"(label = <<b>"as is"</b>>)") != std::string::npos);
+    CHECK(output.find(R"(label = "left\l")") != std::string::npos);
+
+    // Long labels are scanned in vector sized blocks with a scalar tail
+    std::string text, escaped;
+    for (int i = 0; i < 300; ++i) {
+        text += i % 37 ? 'x' : '"';
+        escaped += i % 37 ? "x" : "\\\"";
+    }
+    graph.emplace<Vertex>(5)->label(text);
+    CHECK(generateString(graph).find("label = \"" + escaped + "\"") !=
+          std::string::npos);
+}
+
+TEST_CASE("Duplicate edges are coalesced", "[generate]") {
+    Graph graph(0);
+    graph.emplace<Vertex>(1);
+    graph.emplace<Vertex>(2);
+    for (int i = 0; i < 3; ++i) {
+        graph.add(Edge{ 1, 2 });
+    }
+    graph.add(Edge{ 2, 1 });
+    graph.add(Edge{ 1, 2, Color::Red });
+    auto generateWith = [&](EdgeCoalescing mode) {
+        GenerateOptions options;
+        options.coalesceEdges = mode;
+        return generateString(graph, options);
+    };
+    std::string none = generateWith(EdgeCoalescing::None);
+    CHECK(none == generateString(graph));
+    std::string drop = generateWith(EdgeCoalescing::Drop);
+    CHECK(drop.find("vertex_1 -> vertex_2\n") != std::string::npos);
+    CHECK(drop.find("vertex_1 -> vertex_2\n    vertex_1 -> vertex_2\n") ==
+          std::string::npos);
+    CHECK(drop.find("vertex_2 -> vertex_1\n") != std::string::npos);
+    CHECK(drop.find("vertex_1 -> vertex_2 [color=") != std::string::npos);
+    CHECK(generateWith(EdgeCoalescing::Label).find(
+              "vertex_1 -> vertex_2 [label=\"3\"]") != std::string::npos);
+    CHECK(generateWith(EdgeCoalescing::PenWidth)
+              .find("vertex_1 -> vertex_2 [penwidth=2]") != std::string::npos);
+
+    GenerateOptions parallel;
+    parallel.threads = 4;
+    parallel.coalesceEdges = EdgeCoalescing::Drop;
+    CHECK(generateString(graph, parallel) == drop);
+
+    graph.kind(GraphKind::Undirected);
+    CHECK(generateWith(EdgeCoalescing::Label).find(
+              "vertex_1 -- vertex_2 [label=\"4\"]") != std::string::npos);
+}
+
+TEST_CASE("Compact names do not depend on the raw IDs", "[generate]") {
+    // IDs are derived from addresses that differ between the two graphs
+    char storage[2][3];
+    auto build = [&](char* ids) {
+        auto graph = std::make_unique<Graph>();
+        auto* a = Vertex::make(ID(&ids[0]));
+        auto* b = Vertex::make(ID(&ids[1]));
+        graph->add(a)->add(Graph::make(ID(&ids[2]))->add(b));
+        graph->add(Edge{ b->id(), a->id() });
+        return graph;
+    };
+    auto first = build(storage[0]);
+    auto second = build(storage[1]);
+    BufferSink mapping;
+    GenerateOptions options;
+    options.compactIDs = true;
+    options.idMapping = &mapping;
+    std::string output = generateString(*first, options);
+    CHECK(output == generateString(*second, options));
+    CHECK(output.find("v0 [") != std::string::npos);
+    CHECK(output.find("cluster_v1 {") != std::string::npos);
+    CHECK(output.find("v2 -> v0") != std::string::npos);
+    auto a = ID(&storage[0][0]).raw();
+    CHECK(mapping.view().starts_with("v0 " + std::to_string(a) + "\n"));
+    options.threads = 4;
+    CHECK(generateString(*first, options) == output);
+}
+
+TEST_CASE("generateBatch writes every graph to its file", "[generate]") {
+    TemporaryDirectory dir;
+    std::vector<std::unique_ptr<Graph>> graphs;
+    std::vector<Graph const*> pointers;
+    for (int i = 0; i < 12; ++i) {
+        graphs.push_back(makeNested(2, i % 3));
+        pointers.push_back(graphs.back().get());
+    }
+    auto path = [&](Graph const&, size_t index) {
+        if (index == 5) {
+            return dir / "missing" / "graph.dot";
+        }
+        return dir / ("graph" + std::to_string(index) + ".dot");
+    };
+    GenerateOptions options;
+    options.threads = 3;
+    auto results = generateBatch(pointers, path, options, 2);
+    REQUIRE(results.size() == graphs.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        CHECK(results[i].path == path(*graphs[i], i));
+        if (i == 5) {
+            CHECK(!results[i].ok());
+            continue;
+        }
+        REQUIRE(results[i].ok());
+        CHECK(readFile(results[i].path) == generateString(*graphs[i]));
+    }
+}
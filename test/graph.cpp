@@ -0,0 +1,111 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <graphgen/graphgen.h>
+
+#include "common.h"
+
+using namespace graphgen;
+using namespace graphgen::test;
+
+/// \Returns a graph with two vertices and an edge
+static std::shared_ptr<Graph> makeShared() {
+    auto graph = std::make_shared<Graph>(100);
+    graph->label("Shared")->font("Mono");
+    graph->emplace<Vertex>(101)->label("A");
+    graph->emplace<Vertex>(102)->label("B");
+    graph->add(Edge{ 101, 102 });
+    return graph;
+}
+
+TEST_CASE("Edges keep their order and attributes", "[graph]") {
+    Graph graph(0);
+    for (int i = 1; i <= 4; ++i) {
+        graph.emplace<Vertex>(i);
+    }
+    graph.add(Edge{ 1, 2 });
+    std::vector<Edge> edges = { { 2, 3, Color::Red },
+                                { 3, 4 },
+                                { 4, 1, std::nullopt, Style::Dashed } };
+    graph.addEdges(edges);
+    auto view = graph.edges();
+    REQUIRE(view.size() == 4);
+    CHECK(view.attributes().size() == 2);
+    CHECK(view.from()[3] == ID(4));
+    CHECK(view.to()[3] == ID(1));
+    std::vector<Edge> result(view.begin(), view.end());
+    CHECK(result[0].from == ID(1));
+    CHECK(!result[0].color);
+    CHECK(result[1].color == Color::Red);
+    CHECK(!result[2].color);
+    CHECK(!result[2].style);
+    CHECK(result[3].style == Style::Dashed);
+
+    Graph single(0);
+    for (int i = 1; i <= 4; ++i) {
+        single.emplace<Vertex>(i);
+    }
+    single.add(Edge{ 1, 2 });
+    for (auto& edge: edges) {
+        single.add(edge);
+    }
+    CHECK(generateString(single) == generateString(graph));
+}
+
+TEST_CASE("Shared graphs are copied on write", "[graph]") {
+    auto shared = makeShared();
+    Graph first(0);
+    Graph second(1);
+    auto* a = first.addShared(shared);
+    auto* b = second.addShared(shared);
+    CHECK(a->sharedGraph() == shared.get());
+    CHECK(a->vertices().data() == shared->vertices().data());
+    CHECK(first.find(101) == shared->find(101));
+    std::string before = generateString(second);
+
+    a->emplace<Vertex>(103)->label("C");
+    CHECK(a->sharedGraph() == nullptr);
+    CHECK(a->vertices().size() == 3);
+    CHECK(a->label().text() == "Shared");
+    CHECK(a->font() == "Mono");
+    CHECK(first.find(101) != shared->find(101));
+    CHECK(first.find(101)->parent() == a);
+    CHECK(first.find(103) != nullptr);
+    CHECK(shared->vertices().size() == 2);
+    CHECK(b->sharedGraph() == shared.get());
+    CHECK(generateString(second) == before);
+
+    b->unshare();
+    CHECK(b->sharedGraph() == nullptr);
+    CHECK(generateString(second) == before);
+    CHECK(shared.use_count() == 1);
+}
+
+TEST_CASE("Shared graphs generate like copies", "[graph]") {
+    auto shared = makeShared();
+    std::vector<std::unique_ptr<Graph>> trees, copies;
+    for (int i = 0; i < 3; ++i) {
+        trees.push_back(std::make_unique<Graph>(0));
+        trees.back()->emplace<Graph>(i + 1)->addShared(shared);
+        copies.push_back(std::make_unique<Graph>(0));
+        copies.back()->emplace<Graph>(i + 1)->addShared(shared)->unshare();
+    }
+    GenerateOptions options;
+    options.incremental = true;
+    options.threads = 2;
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t i = 0; i < trees.size(); ++i) {
+            CHECK(generateString(*trees[i], options) ==
+                  generateString(*copies[i]));
+        }
+    }
+
+    // Joining two trees that share a graph duplicates its IDs
+    Graph joined(0);
+    joined.addShared(shared);
+    joined.add(trees[0].release());
+    CHECK(validate(joined).duplicateIDs.size() == 3);
+}
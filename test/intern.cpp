@@ -0,0 +1,62 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <graphgen/graphgen.h>
+
+using namespace graphgen;
+
+TEST_CASE("StringPool stores one copy of every string", "[intern]") {
+    StringPool pool;
+    std::string text = "Helvetica";
+    auto a = pool.intern(text);
+    text[0] = 'X';
+    auto b = pool.intern("Helvetica");
+    CHECK(a == b);
+    CHECK(a.view() == "Helvetica");
+    CHECK(a.view().data() == b.view().data());
+    CHECK(pool.intern("Mono") != a);
+    CHECK(pool.intern("") != InternedString());
+    CHECK(!InternedString());
+    CHECK(pool.size() == 3);
+}
+
+TEST_CASE("StringPool can be used from many threads", "[intern]") {
+    StringPool pool;
+    std::vector<std::thread> threads;
+    std::vector<std::vector<InternedString>> handles(4);
+    for (size_t t = 0; t < handles.size(); ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 1000; ++i) {
+                handles[t].push_back(pool.intern(std::to_string(i % 100)));
+            }
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+    CHECK(pool.size() == 100);
+    for (auto& list: handles) {
+        CHECK(list == handles[0]);
+    }
+}
+
+TEST_CASE("Fonts are interned in the pool of the tree", "[intern]") {
+    Graph graph(0);
+    auto* a = graph.emplace<Vertex>(1)->font("Mono");
+    // Configured before it is added, so it owns a copy of its font first
+    auto* b = Vertex::make(2);
+    b->font("Mono");
+    graph.add(b);
+    auto* subgraph = Graph::make(3);
+    graph.add(subgraph);
+    auto* c = subgraph->emplace<Vertex>(4)->font("Mono");
+    CHECK(a->font()->data() == b->font()->data());
+    CHECK(a->font()->data() == c->font()->data());
+    CHECK(graph.intern("Mono").view().data() == a->font()->data());
+    b->font(std::nullopt);
+    CHECK(!b->font());
+    CHECK(c->font() == "Mono");
+}
@@ -0,0 +1,48 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include <graphgen/graphgen.h>
+
+using namespace graphgen;
+
+TEST_CASE("Labels store short and long text", "[label]") {
+    Label empty;
+    CHECK(empty.text().empty());
+    Label inlined("short");
+    CHECK(inlined.text() == "short");
+    CHECK(inlined.heapSize() == 0);
+    std::string text(100, 'x');
+    Label owned(text, LabelKind::HTML);
+    CHECK(owned.text() == text);
+    CHECK(owned.kind() == LabelKind::HTML);
+    CHECK(owned.heapSize() == text.size());
+    Label copy = owned;
+    CHECK(copy.text() == text);
+    CHECK(copy.text().data() != owned.text().data());
+    Label moved = std::move(copy);
+    CHECK(moved.text() == text);
+    CHECK(copy.text().empty());
+    Label view = Label::view(text);
+    CHECK(view.text().data() == text.data());
+    CHECK(view.heapSize() == 0);
+    copy = view;
+    CHECK(copy.text().data() == text.data());
+}
+
+TEST_CASE("Generated labels call their generator on emission", "[label]") {
+    int calls = 0;
+    Label generated([&](std::ostream& str) {
+        ++calls;
+        str << "gen";
+    });
+    CHECK(generated.isGenerated());
+    CHECK(calls == 0);
+    Label copy = generated;
+    std::ostringstream str;
+    str << copy;
+    CHECK(str.str() == "\"gen\"");
+    CHECK(calls == 1);
+}
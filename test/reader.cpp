@@ -0,0 +1,123 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <string>
+
+#include <graphgen/graphgen.h>
+
+#include "common.h"
+
+using namespace graphgen;
+using namespace graphgen::test;
+
+TEST_CASE("Generated code reads back into the same graph", "[reader]") {
+    auto G = std::make_unique<Graph>(0);
+    G->kind(GraphKind::Directed)
+        ->rankdir(RankDir::LeftRight)
+        ->font("Helvetica")
+        ->add(Vertex::make(1)->label("Plain")->color(Color::Red))
+        ->add(Vertex::make(2)
+                  ->label("Quote \" backslash \\ and\nnewline")
+                  ->shape(VertexShape::Circle)
+                  ->style(Style::Dashed))
+        ->add(Vertex::make(3)
+                  ->label("<b>bold</b><br/>text", LabelKind::HTML)
+                  ->font("SF Mono"))
+        ->add(Graph::make(4)
+                  ->label("Cluster")
+                  ->rankdir(RankDir::BottomTop)
+                  ->add(Vertex::make(5)->label("Inner"))
+                  ->add(Graph::make(6)->add(Vertex::make(7)->label("Deep")))
+                  ->add(Edge{ 5, 7, Color::Blue, Style::Bold }))
+        ->add(Edge{ 1, 2 })
+        ->add(Edge{ 2, 3, std::nullopt, Style::Dotted })
+        ->add(Edge{ 3, 5, Color::Green });
+    std::string first = generateString(*G);
+    auto parsed = parseDot(first);
+    std::string second = generateString(*parsed);
+    CHECK(second == first);
+    CHECK(generateString(*parseDot(second)) == first);
+}
+
+TEST_CASE("Documents refer to the input text", "[reader]") {
+    std::string text = "digraph { a [label = \"A\"]; a -> b; }";
+    auto document = DotDocument::view(text);
+    auto a = document.id("a");
+    auto b = document.id("b");
+    REQUIRE(a);
+    REQUIRE(b);
+    auto* vertex = document.graph().find(*a);
+    REQUIRE(vertex);
+    CHECK(vertex->label().text() == "A");
+    CHECK(document.graph().find(*b)->label().text() == "b");
+    CHECK(document.graph().edges().size() == 1);
+}
+
+TEST_CASE("Foreign names get deterministic IDs that do not collide",
+          "[reader]") {
+    std::string text =
+        "digraph { a -> vertex_3; { b; vertex_1 -> c } vertex_2 -> a }";
+    auto document = DotDocument::view(text);
+    CHECK(validate(document.graph()).ok());
+    CHECK(document.id("vertex_3") == ID(3));
+    CHECK(document.id("a") == ID(4));
+    CHECK(document.id("b") == ID(6));
+    CHECK(document.id("c") == ID(7));
+    std::string first = generateString(document.graph());
+    CHECK(generateString(*parseDot(text)) == first);
+}
+
+TEST_CASE("Deeply nested subgraphs are parsed", "[reader]") {
+    constexpr size_t depth = 10000;
+    std::string text = "graph { ";
+    for (size_t i = 0; i < depth; ++i) {
+        text += "subgraph { ";
+    }
+    text += "x";
+    text.append(depth, '}');
+    text += "}";
+    auto document = DotDocument::view(text);
+    auto* vertex = document.graph().find(*document.id("x"));
+    REQUIRE(vertex);
+    size_t levels = 0;
+    for (auto* v = vertex->parent(); v != &document.graph(); v = v->parent()) {
+        ++levels;
+    }
+    CHECK(levels == depth);
+    text.pop_back();
+    CHECK_THROWS_AS(parseDot(text), DotSyntaxError);
+}
+
+TEST_CASE("Graphviz escapes in foreign labels are preserved", "[reader]") {
+    std::string text = R"(digraph "CFG" {
+        Node0 [shape = record, label = "{entry:\l  %1 = add i32 %a, %b\l  ret i32 %1\l}"];
+        Node1 [label = "\N has \"quotes\""];
+        Node0 -> Node1;
+    })";
+    auto graph = parseDot(text);
+    std::string output = generateString(*graph);
+    CHECK(output.find(R"("{entry:\l  %1 = add i32 %a, %b\l  ret i32 %1\l}")") !=
+          std::string::npos);
+    CHECK(output.find(R"("\N has \"quotes\"")") != std::string::npos);
+    CHECK(output.find(R"(\\l)") == std::string::npos);
+    CHECK(generateString(*parseDot(output)) == output);
+}
+
+TEST_CASE("Plain escapes in foreign labels are decoded", "[reader]") {
+    auto graph = parseDot(R"(graph { a [label = "one\ntwo \"2\""]; })");
+    REQUIRE(graph->vertices().size() == 1);
+    auto const& label = graph->vertices()[0]->label();
+    CHECK(label.kind() == LabelKind::PlainText);
+    CHECK(label.text() == "one\ntwo \"2\"");
+}
+
+TEST_CASE("Syntax errors report their position", "[reader]") {
+    try {
+        parseDot("digraph {\n  a -> ;\n}");
+        FAIL("Expected a syntax error");
+    }
+    catch (DotSyntaxError const& error) {
+        CHECK(error.line() == 2);
+        CHECK(error.column() == 8);
+    }
+}
@@ -0,0 +1,162 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <vector>
+
+#include <graphgen/graphgen.h>
+
+#include "common.h"
+
+using namespace graphgen;
+using namespace graphgen::test;
+
+/// \Returns `true` if \p graph has an edge from \p from to \p to
+static bool hasEdge(Graph const& graph, ID from, ID to) {
+    for (Edge edge: graph.edges()) {
+        if (edge.from == from && edge.to == to) {
+            return true;
+        }
+    }
+    return false;
+}
+
+TEST_CASE("Deep subgraphs are collapsed into a vertex", "[reduce]") {
+    Graph graph(0);
+    auto* subgraph = graph.emplace<Graph>(10);
+    subgraph->label("Sub")->color(Color::Red);
+    subgraph->emplace<Vertex>(11);
+    auto* nested = subgraph->emplace<Graph>(12);
+    nested->emplace<Vertex>(13);
+    nested->emplace<Vertex>(14);
+    nested->add(Edge{ 13, 14 });
+    subgraph->add(Edge{ 11, 13 });
+    graph.emplace<Vertex>(1);
+    graph.add(Edge{ 1, 13 })->add(Edge{ 1, 14 });
+
+    ReduceStats stats;
+    ReduceOptions options;
+    options.maxDepth = 0;
+    options.stats = &stats;
+    auto reduced = reduce(graph, options);
+    REQUIRE(reduced->vertices().size() == 2);
+    auto* summary = reduced->find(10);
+    REQUIRE(summary);
+    CHECK(!summary->isGraph());
+    CHECK(summary->color() == Color::Red);
+    CHECK(summary->label().text().starts_with("Sub\n[collapsed"));
+    CHECK(reduced->find(13) == nullptr);
+    CHECK(reduced->edges().size() == 1);
+    CHECK(hasEdge(*reduced, 1, 10));
+    CHECK(stats.collapsedGraphs == 1);
+    CHECK(stats.collapsedVertices == 4);
+    CHECK(stats.collapsedEdges == 3);
+    CHECK(validate(*reduced).ok());
+    // The input is not changed
+    CHECK(graph.find(13) != nullptr);
+}
+
+TEST_CASE("Large subgraphs are collapsed", "[reduce]") {
+    Graph graph(0);
+    auto* small = graph.emplace<Graph>(10);
+    small->emplace<Vertex>(11);
+    auto* large = graph.emplace<Graph>(20);
+    for (int i = 21; i < 30; ++i) {
+        large->emplace<Vertex>(i);
+    }
+    ReduceOptions options;
+    options.maxGraphSize = 5;
+    auto reduced = reduce(graph, options);
+    CHECK(reduced->find(10)->isGraph());
+    CHECK(!reduced->find(20)->isGraph());
+    CHECK(reduced->find(21) == nullptr);
+}
+
+TEST_CASE("Transitive reduction removes implied edges", "[reduce]") {
+    Graph graph(0);
+    for (int i = 1; i <= 4; ++i) {
+        graph.emplace<Vertex>(i);
+    }
+    graph.add(Edge{ 1, 2 })
+        ->add(Edge{ 2, 3 })
+        ->add(Edge{ 3, 4 })
+        ->add(Edge{ 1, 3 })
+        ->add(Edge{ 1, 4 });
+    ReduceStats stats;
+    ReduceOptions options;
+    options.transitiveReduction = true;
+    options.stats = &stats;
+    auto reduced = reduce(graph, options);
+    CHECK(reduced->edges().size() == 3);
+    CHECK(hasEdge(*reduced, 1, 2));
+    CHECK(!hasEdge(*reduced, 1, 3));
+    CHECK(!hasEdge(*reduced, 1, 4));
+    CHECK(stats.transitiveEdges == 2);
+    CHECK(stats.acyclic);
+
+    graph.add(Edge{ 4, 1 });
+    reduced = reduce(graph, options);
+    CHECK(reduced->edges().size() == 6);
+    CHECK(!stats.acyclic);
+}
+
+TEST_CASE("Transitive reduction keeps edges with attributes", "[reduce]") {
+    Graph graph(0);
+    for (int i = 1; i <= 3; ++i) {
+        graph.emplace<Vertex>(i);
+    }
+    graph.add(Edge{ 1, 2 })
+        ->add(Edge{ 2, 3, Color::Red })
+        ->add(Edge{ 1, 3, Color::Blue })
+        ->add(Edge{ 1, 3 })
+        ->add(Edge{ 1, 2, std::nullopt, Style::Dashed })
+        ->add(Edge{ 1, 2 });
+    ReduceStats stats;
+    ReduceOptions options;
+    options.transitiveReduction = true;
+    options.stats = &stats;
+    auto reduced = reduce(graph, options);
+    CHECK(stats.transitiveEdges == 2);
+    REQUIRE(reduced->edges().size() == 4);
+    std::vector<Edge> expected = { { 1, 2 },
+                                   { 2, 3, Color::Red },
+                                   { 1, 3, Color::Blue },
+                                   { 1, 2, std::nullopt, Style::Dashed } };
+    size_t i = 0;
+    for (Edge edge: reduced->edges()) {
+        CHECK(edge.from == expected[i].from);
+        CHECK(edge.to == expected[i].to);
+        CHECK(edge.color == expected[i].color);
+        CHECK(edge.style == expected[i].style);
+        ++i;
+    }
+}
+
+TEST_CASE("Fan-out is limited in declaration order", "[reduce]") {
+    Graph graph(0);
+    for (int i = 1; i <= 5; ++i) {
+        graph.emplace<Vertex>(i);
+    }
+    for (int i = 2; i <= 5; ++i) {
+        graph.add(Edge{ 1, i });
+    }
+    ReduceStats stats;
+    ReduceOptions options;
+    options.maxFanOut = 2;
+    options.stats = &stats;
+    auto reduced = reduce(graph, options);
+    CHECK(reduced->edges().size() == 2);
+    CHECK(hasEdge(*reduced, 1, 2));
+    CHECK(hasEdge(*reduced, 1, 3));
+    CHECK(stats.fanOutEdges == 2);
+}
+
+TEST_CASE("Reduction can be applied while generating", "[reduce]") {
+    Graph graph(0);
+    graph.emplace<Graph>(1)->emplace<Vertex>(2);
+    ReduceOptions reduceOptions;
+    reduceOptions.maxDepth = 0;
+    GenerateOptions options;
+    options.reduce = &reduceOptions;
+    CHECK(generateString(graph, options) ==
+          generateString(*reduce(graph, reduceOptions)));
+}
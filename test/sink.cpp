@@ -0,0 +1,126 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <system_error>
+
+#include <graphgen/graphgen.h>
+
+#include "common.h"
+
+using namespace graphgen;
+using namespace graphgen::test;
+
+/// \Returns a few megabytes of text with line numbers
+static std::string largeText() {
+    std::string text;
+    for (int i = 0; text.size() < (size_t(3) << 20); ++i) {
+        text += "line " + std::to_string(i) + "\n";
+    }
+    return text;
+}
+
+TEST_CASE("BufferSink collects all writes", "[sink]") {
+    BufferSink sink(4);
+    sink << "abc" << 'd' << 42 << std::string_view("efg");
+    sink.writeNumber(int64_t(-7));
+    sink.ostream() << 1.5 << std::flush;
+    CHECK(sink.view() == "abcd42efg-71.5");
+    CHECK(sink.bytesWritten() == sink.size());
+    std::string text = largeText();
+    sink.write(text);
+    CHECK(sink.view().substr(14) == text);
+    sink.clear();
+    CHECK(sink.view().empty());
+    sink << "x";
+    CHECK(sink.str() == "x");
+}
+
+TEST_CASE("FileSink writes files in blocks", "[sink]") {
+    TemporaryDirectory dir;
+    std::string text = largeText();
+    {
+        FileSink sink(dir / "a.txt", 4096);
+        sink.write(text);
+        sink << "end";
+        CHECK(sink.bytesWritten() == text.size() + 3);
+    }
+    CHECK(readFile(dir / "a.txt") == text + "end");
+    FileSink sink(dir / "b.txt");
+    sink << "first";
+    sink.open(dir / "c.txt");
+    sink << "second";
+    sink.flush();
+    CHECK(readFile(dir / "b.txt") == "first");
+    CHECK(readFile(dir / "c.txt") == "second");
+}
+
+TEST_CASE("FileSink reports errors", "[sink]") {
+    TemporaryDirectory dir;
+    CHECK_THROWS_AS(FileSink(dir / "missing" / "a.txt"), std::system_error);
+    FileSink sink(-1);
+    sink << "text";
+    CHECK_THROWS_AS(sink.flush(), std::system_error);
+}
+
+TEST_CASE("AsyncFileSink writes the same data as FileSink", "[sink]") {
+    TemporaryDirectory dir;
+    std::string text = largeText();
+    {
+        AsyncFileSink sink(dir / "a.txt", 4096, 3);
+        sink.write(text);
+        sink.flush();
+        CHECK(readFile(dir / "a.txt") == text);
+        sink << "end";
+    }
+    CHECK(readFile(dir / "a.txt") == text + "end");
+}
+
+TEST_CASE("AsyncFileSink reports errors", "[sink]") {
+    TemporaryDirectory dir;
+    CHECK_THROWS_AS(AsyncFileSink(dir / "missing" / "a.txt"),
+                    std::system_error);
+    AsyncFileSink sink(-1, 4096, 2);
+    // The error surfaces either when a full block waits for the writer or
+    // when the sink is flushed
+    CHECK_THROWS_AS(
+        [&] {
+        sink.write(largeText());
+        sink.flush();
+    }(),
+        std::system_error);
+}
+
+TEST_CASE("OStreamSink passes data to the stream", "[sink]") {
+    std::ostringstream str;
+    {
+        OStreamSink sink(str, 16);
+        sink << "some text that is longer than the block";
+    }
+    CHECK(str.str() == "some text that is longer than the block");
+}
+
+TEST_CASE("generate writes the same code to sinks and streams", "[sink]") {
+    Graph graph(0);
+    graph.emplace<Vertex>(1)->label("A");
+    graph.emplace<Graph>(2)->label("Sub")->emplace<Vertex>(3)->label("B");
+    graph.add(Edge{ 1, 3 });
+    std::ostringstream str;
+    generate(graph, str);
+    CHECK(generateString(graph) == str.str());
+}
+
+TEST_CASE("generateAsync writes the file or reports the error", "[sink]") {
+    TemporaryDirectory dir;
+    Graph graph(0);
+    for (int i = 1; i <= 100; ++i) {
+        graph.emplace<Vertex>(i)->label("Vertex " + std::to_string(i));
+        graph.add(Edge{ i, i % 100 + 1 });
+    }
+    generateAsync(graph, dir / "graph.dot", {}, 1024).get();
+    CHECK(readFile(dir / "graph.dot") == generateString(graph));
+    auto failed = generateAsync(graph, dir / "missing" / "graph.dot");
+    CHECK_THROWS_AS(failed.get(), std::system_error);
+}
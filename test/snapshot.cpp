@@ -0,0 +1,153 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <graphgen/graphgen.h>
+
+#include "common.h"
+
+using namespace graphgen;
+using namespace graphgen::test;
+
+/// Builds a graph that uses every attribute the snapshot format stores
+static std::unique_ptr<Graph> makeGraph() {
+    auto graph = std::make_unique<Graph>(0);
+    graph->font("Helvetica")->rankdir(RankDir::LeftRight);
+    graph->emplace<Vertex>(1)->label("A")->color(Color::Red);
+    auto* subgraph = graph->emplace<Graph>(2);
+    subgraph->label("<b>Sub</b>", LabelKind::HTML)->style(Style::Dashed);
+    subgraph->emplace<Vertex>(3)
+        ->label([](std::ostream& str) { str << "Generated"; })
+        ->shape(VertexShape::Circle)
+        ->font("Mono");
+    subgraph->emplace<Graph>(4)->emplace<Vertex>(5)->label("left\\l",
+                                                           LabelKind::Escaped);
+    subgraph->add(Edge{ 3, 5, Color::Blue });
+    graph->add(Edge{ 1, 3 })->add(Edge{ 1, 3 })->add(
+        Edge{ 5, 1, std::nullopt, Style::Bold });
+    return graph;
+}
+
+/// \Returns a copy of \p data in memory that is aligned for `Snapshot::view()`
+static std::vector<uint64_t> alignedCopy(std::string_view data) {
+    std::vector<uint64_t> buffer((data.size() + 7) / 8);
+    std::memcpy(buffer.data(), data.data(), data.size());
+    return buffer;
+}
+
+static Snapshot view(std::vector<uint64_t> const& buffer, size_t size) {
+    auto* data = reinterpret_cast<char const*>(buffer.data());
+    return Snapshot::view({ data, size });
+}
+
+TEST_CASE("Loaded snapshots generate like the saved graph", "[snapshot]") {
+    TemporaryDirectory dir;
+    auto graph = makeGraph();
+    saveSnapshot(*graph, dir / "graph.snapshot");
+    auto snapshot = Snapshot::load(dir / "graph.snapshot");
+    CHECK(snapshot.numVertices() == 6);
+    CHECK(snapshot.numEdges() == 4);
+    auto root = snapshot.root();
+    CHECK(root.isRoot());
+    CHECK(root.rankdir() == RankDir::LeftRight);
+    CHECK(root.font() == "Helvetica");
+    auto first = *root.vertices().begin();
+    CHECK(first.id() == ID(1));
+    CHECK(first.label().text() == "A");
+    CHECK(first.color() == Color::Red);
+    CHECK(generateString(snapshot) == generateString(*graph));
+
+    GenerateOptions options;
+    options.compactIDs = true;
+    options.coalesceEdges = EdgeCoalescing::Label;
+    GenerateStats graphStats, snapshotStats;
+    options.stats = &graphStats;
+    std::string expected = generateString(*graph, options);
+    options.stats = &snapshotStats;
+    CHECK(generateString(snapshot, options) == expected);
+    CHECK(snapshotStats.vertices == graphStats.vertices);
+    CHECK(snapshotStats.edges == graphStats.edges);
+    CHECK(snapshotStats.subgraphs == graphStats.subgraphs);
+    CHECK(snapshotStats.maxDepth == graphStats.maxDepth);
+    CHECK(snapshotStats.bytesWritten == expected.size());
+    REQUIRE(snapshotStats.subgraphTimes.size() == 1);
+    CHECK(snapshotStats.subgraphTimes[0].id == ID(2));
+}
+
+TEST_CASE("Snapshots can be used from memory", "[snapshot]") {
+    auto graph = makeGraph();
+    BufferSink sink;
+    saveSnapshot(*graph, sink);
+    auto buffer = alignedCopy(sink.view());
+    auto snapshot = view(buffer, sink.size());
+    CHECK(generateString(snapshot) == generateString(*graph));
+}
+
+TEST_CASE("Truncated snapshots are rejected", "[snapshot]") {
+    TemporaryDirectory dir;
+    BufferSink sink;
+    saveSnapshot(*makeGraph(), sink);
+    for (size_t size: { size_t(0), size_t(10), size_t(64), size_t(100),
+                        sink.size() - 1 })
+    {
+        {
+            std::ofstream file(dir / "truncated", std::ios::binary);
+            file.write(sink.view().data(), static_cast<std::streamsize>(size));
+        }
+        CHECK_THROWS_AS(Snapshot::load(dir / "truncated"), std::runtime_error);
+    }
+    CHECK_THROWS_AS(Snapshot::load(dir / "missing"), std::system_error);
+}
+
+TEST_CASE("Corrupt snapshots are rejected", "[snapshot]") {
+    BufferSink sink;
+    saveSnapshot(*makeGraph(), sink);
+    std::string original(sink.view());
+    // Offsets follow the layout of the header and of the vertex records that
+    // start right after it, see lib/snapshot.cpp
+    constexpr size_t nodes = 64, record = 64;
+    auto corrupt = [&](size_t offset, auto value) {
+        std::string data = original;
+        std::memcpy(data.data() + offset, &value, sizeof value);
+        auto buffer = alignedCopy(data);
+        return [buffer, size = data.size()] { view(buffer, size); };
+    };
+    CHECK_NOTHROW(corrupt(0, 'G')());
+    CHECK_THROWS_AS(corrupt(0, 'X')(), std::runtime_error);
+    // Version and byte order
+    CHECK_THROWS_AS(corrupt(8, uint32_t(2))(), std::runtime_error);
+    CHECK_THROWS_AS(corrupt(12, uint32_t(0x04030201))(), std::runtime_error);
+    // Number of vertices and offset of the edges
+    CHECK_THROWS_AS(corrupt(16, uint64_t(1) << 60)(), std::runtime_error);
+    CHECK_THROWS_AS(corrupt(40, uint64_t(-8))(), std::runtime_error);
+    // Subtree of the first subgraph, record 2, reaching past its parent
+    CHECK_THROWS_AS(corrupt(nodes + 2 * record + 8, uint64_t(10))(),
+                    std::runtime_error);
+    // Children of a plain vertex, record 1
+    CHECK_THROWS_AS(corrupt(nodes + record + 8, uint64_t(1))(),
+                    std::runtime_error);
+    // Label offset and size
+    CHECK_THROWS_AS(corrupt(nodes + record + 32, uint64_t(-1))(),
+                    std::runtime_error);
+    CHECK_THROWS_AS(corrupt(nodes + record + 48, uint32_t(1) << 30)(),
+                    std::runtime_error);
+    // Edges of the root
+    CHECK_THROWS_AS(corrupt(nodes + 24, uint64_t(100))(), std::runtime_error);
+    // Label kind, shape and color
+    CHECK_THROWS_AS(corrupt(nodes + record + 57, uint8_t(3))(),
+                    std::runtime_error);
+    CHECK_THROWS_AS(corrupt(nodes + record + 58, uint8_t(100))(),
+                    std::runtime_error);
+    CHECK_THROWS_AS(corrupt(nodes + record + 59, uint8_t(200))(),
+                    std::runtime_error);
+    // Graph kinds the generator does not support
+    CHECK_NOTHROW(corrupt(nodes + 61, uint8_t(GraphKind::Undirected))());
+    CHECK_THROWS_AS(corrupt(nodes + 61, uint8_t(GraphKind::Tree))(),
+                    std::runtime_error);
+}
@@ -0,0 +1,75 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+#include <graphgen/graphgen.h>
+
+#include "common.h"
+
+using namespace graphgen;
+using namespace graphgen::test;
+
+/// Adds \p count finished subgraphs with a few vertices and edges to \p graph
+static void addFinishedSubgraphs(Graph& graph, int first, int count) {
+    for (int i = first; i < first + count; ++i) {
+        auto* subgraph = graph.emplace<Graph>(i * 100);
+        subgraph->label("Subgraph " + std::to_string(i))->font("Courier");
+        subgraph->emplace<Vertex>(i * 100 + 1)->label("A")->shape(
+            VertexShape::Circle);
+        subgraph->emplace<Vertex>(i * 100 + 2)
+            ->label("B with a label that does not fit inline")
+            ->color(Color::Red);
+        subgraph->add(Edge{ i * 100 + 1, i * 100 + 2, Color::Blue });
+        subgraph->finish();
+    }
+}
+
+TEST_CASE("Spilled graphs generate like graphs in memory", "[spill]") {
+    TemporaryDirectory dir;
+    Graph reference(0);
+    addFinishedSubgraphs(reference, 1, 20);
+    Graph budgeted(0);
+    budgeted.memoryBudget(0, dir.path());
+    addFinishedSubgraphs(budgeted, 1, 20);
+    auto const* first = static_cast<Graph const*>(budgeted.vertices()[0]);
+    REQUIRE(first->isSpilled());
+    CHECK(first->vertices().empty());
+    CHECK(budgeted.find(101) == first);
+    auto copy = first->readSpilled();
+    REQUIRE(copy);
+    CHECK(copy->vertices().size() == 2);
+    CHECK(copy->vertices()[1]->label().text() ==
+          "B with a label that does not fit inline");
+    CHECK(copy->edges().size() == 1);
+    CHECK(validate(budgeted).ok());
+    CHECK(generateString(budgeted) == generateString(reference));
+    CHECK(generateString(budgeted) == generateString(reference));
+}
+
+TEST_CASE("Memory budget on a nested graph forces serial generation",
+          "[spill]") {
+    Graph reference(0);
+    addFinishedSubgraphs(*reference.emplace<Graph>(1), 1, 8);
+    Graph budgeted(0);
+    auto* nested = budgeted.emplace<Graph>(1);
+    nested->memoryBudget(0);
+    addFinishedSubgraphs(*nested, 1, 8);
+    REQUIRE(budgeted.hasMemoryBudgetInTree());
+    REQUIRE(static_cast<Graph const*>(nested->vertices()[0])->isSpilled());
+    std::string expected = generateString(reference);
+    GenerateOptions options;
+    options.threads = 4;
+    CHECK(generateString(budgeted, options) == expected);
+    options.incremental = true;
+    CHECK(generateString(budgeted, options) == expected);
+    CHECK(generateString(budgeted, options) == expected);
+}
+
+TEST_CASE("Memory budget propagates when a graph is attached", "[spill]") {
+    auto nested = std::make_unique<Graph>(1);
+    nested->memoryBudget(0);
+    Graph root(0);
+    CHECK(!root.hasMemoryBudgetInTree());
+    root.add(std::move(nested));
+    CHECK(root.hasMemoryBudgetInTree());
+}
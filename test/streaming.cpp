@@ -0,0 +1,57 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <string>
+
+#include <graphgen/graphgen.h>
+
+using namespace graphgen;
+
+TEST_CASE("Streaming writer matches generating the tree", "[streaming]") {
+    BufferSink streamed;
+    {
+        StreamingGraphWriter writer(streamed);
+        writer.beginGraph(0)->font("Helvetica")->rankdir(RankDir::LeftRight);
+        writer.vertex(1)->label("A")->color(Color::Red);
+        writer.beginSubgraph(2)->label("Sub")->style(Style::Dashed);
+        writer.vertex(3)->label("B")->shape(VertexShape::Circle)->font("Mono");
+        writer.endSubgraph();
+        writer.edge({ 1, 3, Color::Blue });
+        writer.endGraph();
+    }
+    auto G = std::make_unique<Graph>(0);
+    G->font("Helvetica")
+        ->rankdir(RankDir::LeftRight)
+        ->add(Vertex::make(1)->label("A")->color(Color::Red))
+        ->add(Graph::make(2)
+                  ->label("Sub")
+                  ->style(Style::Dashed)
+                  ->add(Vertex::make(3)
+                            ->label("B")
+                            ->shape(VertexShape::Circle)
+                            ->font("Mono")))
+        ->add(Edge{ 1, 3, Color::Blue });
+    BufferSink generated;
+    generate(*G, generated);
+    CHECK(streamed.view() == generated.view());
+}
+
+TEST_CASE("Streaming elements expose the vertex setters", "[streaming]") {
+    BufferSink sink;
+    StreamingGraphWriter writer(sink);
+    auto* element = writer.beginGraph(0);
+    element->label("Root", LabelKind::PlainText)
+        ->shape(VertexShape::Box)
+        ->font("Helvetica")
+        ->color(Color::Green)
+        ->style(Style::Bold);
+    CHECK(element->label().text() == "Root");
+    CHECK(element->font() == "Helvetica");
+    CHECK(element->color() == Color::Green);
+    CHECK(element->style() == Style::Bold);
+    element->font(std::nullopt);
+    CHECK(!element->font());
+    writer.endGraph();
+    CHECK(std::string(sink.view()).find("label = \"Root\"") !=
+          std::string::npos);
+}
@@ -0,0 +1,88 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#include <graphgen/graphgen.h>
+
+#include "common.h"
+
+using namespace graphgen;
+using namespace graphgen::test;
+
+TEST_CASE("Vertices are indexed by ID", "[validate]") {
+    Graph graph(0);
+    auto* subgraph = Graph::make(1);
+    subgraph->add(Vertex::make(2)->label("Loose"));
+    graph.add(subgraph);
+    graph.emplace<Vertex>(3);
+    graph.emplace<Vertex>(3);
+    CHECK(graph.find(2)->label().text() == "Loose");
+    CHECK(graph.find(1) == subgraph);
+    CHECK(subgraph->find(3) != nullptr);
+    CHECK(graph.find(4) == nullptr);
+    CHECK(graph.duplicateIDs().size() == 1);
+}
+
+TEST_CASE("Valid graphs pass validation", "[validate]") {
+    Graph graph(0);
+    graph.emplace<Vertex>(1);
+    graph.emplace<Graph>(2)->emplace<Vertex>(3);
+    graph.add(Edge{ 1, 3 });
+    CHECK(validate(graph).ok());
+}
+
+TEST_CASE("Validation reports duplicate IDs and dangling edges",
+          "[validate]") {
+    Graph graph(0);
+    graph.emplace<Vertex>(1);
+    graph.emplace<Vertex>(1);
+    graph.emplace<Vertex>(2);
+    auto* subgraph = graph.emplace<Graph>(3);
+    subgraph->emplace<Vertex>(4);
+    subgraph->add(Edge{ 4, 99 });
+    graph.add(Edge{ 1, 2 })->add(Edge{ 1, 3 });
+    auto result = validate(graph);
+    CHECK(!result.ok());
+    CHECK(result.duplicateIDs == std::vector<ID>{ 1 });
+    REQUIRE(result.danglingEdges.size() == 2);
+    auto dangling = [&](ID from, ID to) {
+        return std::ranges::any_of(result.danglingEdges, [&](Edge const& e) {
+            return e.from == from && e.to == to;
+        });
+    };
+    CHECK(dangling(4, 99));
+    CHECK(dangling(1, 3));
+}
+
+TEST_CASE("Validation reports malformed HTML labels", "[validate]") {
+    Graph graph(0);
+    std::string row(100, 'x');
+    graph.emplace<Vertex>(1)->label("<b>" + row + "</b>", LabelKind::HTML);
+    graph.emplace<Vertex>(2)->label("<b>" + row + "</b", LabelKind::HTML);
+    graph.emplace<Vertex>(3)->label(row + ">" + row, LabelKind::HTML);
+    graph.emplace<Vertex>(4)->label(row + ">", LabelKind::PlainText);
+    graph.emplace<Vertex>(5)->label([](std::ostream& str) { str << ">"; },
+                                    LabelKind::HTML);
+    graph.emplace<Graph>(6)->label("<<i>x</i>", LabelKind::HTML);
+    auto result = validate(graph);
+    CHECK(!result.ok());
+    CHECK(result.malformedLabels == std::vector<ID>{ 2, 3, 6 });
+}
+
+TEST_CASE("generate() validates on request", "[validate]") {
+    Graph graph(0);
+    graph.emplace<Vertex>(1);
+    graph.add(Edge{ 1, 2 });
+    CHECK_NOTHROW(generateString(graph));
+    GenerateOptions options;
+    options.validate = true;
+    try {
+        generateString(graph, options);
+        FAIL("Expected InvalidGraphError");
+    }
+    catch (InvalidGraphError const& error) {
+        REQUIRE(error.result().danglingEdges.size() == 1);
+        CHECK(error.result().danglingEdges[0].to == ID(2));
+    }
+}